@@ -9,6 +9,15 @@ struct Architecture {
     return false;
   }
 
+  virtual auto clone() const -> Architecture* {
+    return new Architecture{*this};
+  }
+
+  //false while part of a byte is still waiting to be written
+  virtual auto aligned() const -> bool {
+    return true;
+  }
+
   //
 
   auto pc() const -> uint {
@@ -23,6 +32,28 @@ struct Architecture {
     self.endian = endian;
   }
 
+  auto relaxing() const -> bool {
+    return self.relaxSizes;
+  }
+
+  auto objectMode() const -> bool {
+    return (bool)self.objectFilename;
+  }
+
+  auto section() const -> int {
+    return self.pcGroup();
+  }
+
+  auto reference(const string& expression) -> Bass::Reference {
+    return self.reference(expression);
+  }
+
+  //records an instruction for the linker to encode again
+  auto relocate(const string& opcode, const vector<Bass::Reference>& operands) -> void {
+    if(!self.writePhase()) return;
+    self.relocations.append({self.sectionIndex, self.origin, (int)self.pc(), self.endian, 0, opcode, operands});
+  }
+
   auto directives() -> Bass::Directives& {
     return self.directives;
   }
@@ -35,6 +66,10 @@ struct Architecture {
     return self.evaluate(expression, mode);
   }
 
+  auto evaluateQuietly(const string& expression) -> maybe<int64_t> {
+    return self.evaluateQuietly(expression);
+  }
+
   auto write(uint64_t data, uint length = 1) -> void {
     return self.write(data, length);
   }
@@ -13,13 +13,58 @@ auto Table::assemble(const string& statement) -> bool {
     return true;
   }
 
-  uint pc = Architecture::pc();
+  values.reset();
+  auto match = this->match(s, {});
+  if(!match.opcode) return false;
+
+  //with size relaxation, operands without a size hint are then matched by the size of their value,
+  //among the entries of the same form (e.g. lda *08, lda *16 and lda *24)
+  //if none has a field of that size, or an operand has no value, the entry matched as usual is used
+  if(relaxing()) {
+    if(auto sized = this->match(s, match.opcode->pattern); sized.opcode) match = sized;
+  }
+  auto& opcode = *match.opcode;
+  auto& args = match.args;
+
+  //in object mode, operands that refer to labels or externs may need relocating:
+  //the linker then encodes the instruction again from this table entry, once their addresses are known
+  if(objectMode()) {
+    vector<Bass::Reference> operands;
+    for(auto& arg : args) operands.append(reference(arg));
+    bool relocated = false;
+    for(uint n : range(operands.size())) {
+      if(operands[n].group == Bass::Reference::Absolute) continue;
+      //branches within a section do not depend on where the section is placed
+      bool relative = operands[n].group == section() && operands[n].linear();
+      for(auto& format : opcode.format) {
+        if(format.type == Format::Type::Static || format.argument != n) continue;
+        if(format.type != Format::Type::Relative && format.type != Format::Type::RelativeShiftRight) relative = false;
+      }
+      if(!relative) relocated = true;
+    }
+    if(relocated) {
+      if(!aligned()) error("relocated instruction does not start on a byte boundary");
+      relocate(opcode.text, operands);
+    }
+    encode(opcode, [&](uint n) -> int64_t { return operands[n].value; }, !relocated);
+    if(relocated && !aligned()) error("relocated instruction does not end on a byte boundary");
+    return true;
+  }
 
-  for(auto& opcode : table) {
-    if(!tokenize(s, opcode.pattern)) continue;
+  encode(opcode, [&](uint n) -> int64_t { return operand(args[n], false)(); }, true);
+  return true;
+}
+
+//finds the first entry the statement matches, or with a pattern, the first entry of that form its operand values fit
+auto Table::match(const string& statement, const string& pattern) -> Match {
+  bool sized = (bool)pattern;
+  for(auto entry : table) {
+    auto& opcode = *entry;
+    if(sized && opcode.pattern != pattern) continue;
+    if(!tokenize(statement, opcode.pattern)) continue;
 
     string_vector args;
-    tokenize(args, s, opcode.pattern);
+    tokenize(args, statement, opcode.pattern);
     if(args.size() != opcode.number.size()) continue;
 
     bool mismatch = false;
@@ -27,6 +72,15 @@ auto Table::assemble(const string& statement) -> bool {
       if(format.type == Format::Type::Absolute) {
         if(format.match != Format::Match::Weak) {
           uint bits = bitLength(args[format.argument]);
+          if(!bits && sized) {
+            //operands of generic entries may not be expressions at all (e.g. "nz,label" for "jp *16")
+            auto value = operand(args[format.argument], true);
+            if(!value) {
+              mismatch = true;
+              break;
+            }
+            bits = valueLength(value());
+          }
           if(bits != opcode.number[format.argument].bits) {
             if(format.match == Format::Match::Exact || bits != 0) {
               mismatch = true;
@@ -37,84 +91,105 @@ auto Table::assemble(const string& statement) -> bool {
       }
     }
     if(mismatch) continue;
+    return {&opcode, move(args)};
+  }
+  return {};
+}
 
-    for(auto& format : opcode.format) {
-      switch(format.type) {
-        case Format::Type::Static: {
-          writeBits(format.data, format.bits);
-          break;
-        }
+//operands are evaluated once per statement, so that matching by size and encoding use the same value
+//quiet evaluations are for matching only: an operand that cannot be evaluated then has no value
+auto Table::operand(const string& text, bool quiet) -> maybe<int64_t> {
+  for(auto& value : values) {
+    if(value.text == text) return value.value;
+  }
+  maybe<int64_t> value = quiet ? evaluateQuietly(text) : maybe<int64_t>{evaluate(text)};
+  if(value) values.append({text, value()});
+  return value;
+}
 
-        case Format::Type::Absolute: {
-          uint data = evaluate(args[format.argument]);
-          writeBits(data, opcode.number[format.argument].bits);
-          break;
-        }
+//writes the first table entry with the given operand values (used by the linker)
+auto Table::encode(const vector<int64_t>& operands) -> void {
+  if(!table) error("invalid relocation table entry");
+  encode(*table.first(), [&](uint n) -> int64_t { return operands[n]; }, true);
+  if(!aligned()) error("relocated instruction does not end on a byte boundary");
+}
 
-        case Format::Type::Relative: {
-          int data = evaluate(args[format.argument]) - (pc + format.displacement);
-          uint bits = opcode.number[format.argument].bits;
-          int min = -(1 << (bits - 1)), max = +(1 << (bits - 1)) - 1;
-          if(data < min || data > max) {
-            error("branch out of bounds: ", data);
-          }
-          writeBits(data, opcode.number[format.argument].bits);
-          break;
-        }
+//range checks are skipped for placeholder values that the linker will replace
+auto Table::encode(const Opcode& opcode, const function<int64_t (uint)>& value, bool checked) -> void {
+  uint pc = Architecture::pc();
 
-        case Format::Type::Repeat: {
-          uint data = evaluate(args[format.argument]);
-          for(uint n : range(data)) {
-            writeBits(format.data, opcode.number[format.argument].bits);
-          }
-          break;
-        }
+  for(auto& format : opcode.format) {
+    switch(format.type) {
+      case Format::Type::Static: {
+        writeBits(format.data, format.bits);
+        break;
+      }
 
-        case Format::Type::ShiftRight: {
-          uint64_t data = evaluate(args[format.argument]);
-          writeBits(data >> format.data, opcode.number[format.argument].bits);
-          break;
-        }
+      case Format::Type::Absolute: {
+        uint data = value(format.argument);
+        writeBits(data, opcode.number[format.argument].bits);
+        break;
+      }
 
-        case Format::Type::ShiftLeft: {
-          uint64_t data = evaluate(args[format.argument]);
-          writeBits(data << format.data, opcode.number[format.argument].bits);
-          break;
+      case Format::Type::Relative: {
+        int data = value(format.argument) - (pc + format.displacement);
+        uint bits = opcode.number[format.argument].bits;
+        int min = -(1 << (bits - 1)), max = +(1 << (bits - 1)) - 1;
+        if(checked && (data < min || data > max)) {
+          error("branch out of bounds: ", data);
         }
+        writeBits(data, opcode.number[format.argument].bits);
+        break;
+      }
 
-        case Format::Type::RelativeShiftRight: {
-          int data = evaluate(args[format.argument]) - (pc + format.displacement);
-          unsigned bits = opcode.number[format.argument].bits;
-          int min = -(1 << (bits - 1)), max = +(1 << (bits - 1)) - 1;
-          if(data < min || data > max) error("branch out of bounds");
-          bits -= format.data;
-          if (endian() == Bass::Endian::LSB) {
-            writeBits(data >> format.data, bits);
-          } else {
-            data >>= format.data;
-            writeBits(swapEndian(data, bits), bits);
-          }
-          break;
+      case Format::Type::Repeat: {
+        uint data = value(format.argument);
+        for(uint n : range(data)) {
+          writeBits(format.data, opcode.number[format.argument].bits);
         }
+        break;
+      }
+
+      case Format::Type::ShiftRight: {
+        uint64_t data = value(format.argument);
+        writeBits(data >> format.data, opcode.number[format.argument].bits);
+        break;
+      }
+
+      case Format::Type::ShiftLeft: {
+        uint64_t data = value(format.argument);
+        writeBits(data << format.data, opcode.number[format.argument].bits);
+        break;
+      }
 
-        case Format::Type::Negative: {
-          unsigned data = evaluate(args[format.argument]);
-          writeBits(-data, opcode.number[format.argument].bits);
-          break;
+      case Format::Type::RelativeShiftRight: {
+        int data = value(format.argument) - (pc + format.displacement);
+        unsigned bits = opcode.number[format.argument].bits;
+        int min = -(1 << (bits - 1)), max = +(1 << (bits - 1)) - 1;
+        if(checked && (data < min || data > max)) error("branch out of bounds");
+        bits -= format.data;
+        if (endian() == Bass::Endian::LSB) {
+          writeBits(data >> format.data, bits);
+        } else {
+          data >>= format.data;
+          writeBits(swapEndian(data, bits), bits);
         }
+        break;
+      }
 
-        case Format::Type::NegativeShiftRight: {
-          uint64_t data = evaluate(args[format.argument]);
-          writeBits(-data >> format.data, opcode.number[format.argument].bits);
-          break;
-        }        
+      case Format::Type::Negative: {
+        unsigned data = value(format.argument);
+        writeBits(-data, opcode.number[format.argument].bits);
+        break;
       }
-    }
 
-    return true;
+      case Format::Type::NegativeShiftRight: {
+        uint64_t data = value(format.argument);
+        writeBits(-data >> format.data, opcode.number[format.argument].bits);
+        break;
+      }        
+    }
   }
-
-  return false;
 }
 
 auto Table::bitLength(string& text) const -> uint {
@@ -151,6 +226,14 @@ auto Table::bitLength(string& text) const -> uint {
   return 0;
 }
 
+//smallest number of whole bytes that holds a value (or 0 for negative values)
+auto Table::valueLength(int64_t value) -> uint {
+  if(value < 0) return 0;
+  uint bits = 8;
+  while(bits < 64 && value >> bits) bits += 8;
+  return bits;
+}
+
 auto Table::writeBits(uint64_t data, uint length) -> void {
   function<uint64_t(unsigned)> setBits = [&](unsigned n) -> uint64_t {
     // Create a bit mask with the n least significant bits set
@@ -167,38 +250,66 @@ auto Table::writeBits(uint64_t data, uint length) -> void {
   }  
 }
 
+//commands are applied to this table (and its assembler) every time, while opcodes are parsed only once per process
 auto Table::parseTable(const string& text) -> bool {
-  auto lines = text.split("\n");
-  for(auto& line : lines) {
-    if(auto position = line.find("//")) line.resize(position());  //remove comments
-
-    if(line[0] == '#') {
-      if(line == "#endian lsb") { setEndian(Bass::Endian::LSB); continue; }
-      if(line == "#endian msb") { setEndian(Bass::Endian::MSB); continue; }
-
-      if(auto position = line.find("#include ") ) {
-        line.trimLeft("#include ", 1L);
-        auto more = readArchitecture(line.strip());
-        parseTable(more);
-        continue;
-      }
-      if(auto position = line.find("#directive ") ) {
-        parseDirective(line);
-      }
+  for(auto& line : parse(text)) {
+    if(!line.command) {
+      table.append(&line.opcode);
+      continue;
     }
 
-    auto part = line.split(";", 1L).strip();
-    if(part.size() != 2) continue;
+    string command = line.command;
+    if(command == "#endian lsb") { setEndian(Bass::Endian::LSB); continue; }
+    if(command == "#endian msb") { setEndian(Bass::Endian::MSB); continue; }
 
-    Opcode opcode;
-    assembleTableLHS(opcode, part(0));
-    assembleTableRHS(opcode, part(1));
-    table.append(opcode);
+    if(auto position = command.find("#include ") ) {
+      command.trimLeft("#include ", 1L);
+      auto more = readArchitecture(command.strip());
+      parseTable(more);
+      continue;
+    }
+    if(auto position = command.find("#directive ") ) {
+      parseDirective(command);
+    }
   }
 
   return true;
 }
 
+//splits an architecture file into commands and opcodes
+//the result is shared by every Table in the process (see -batch), and is never modified once parsed
+auto Table::parse(const string& text) -> const vector<Line>& {
+  {
+    lock_guard<mutex> lock(parsedLock);
+    if(auto lines = parsed.find(text)) return lines();
+  }
+
+  vector<Line> lines;
+  for(auto& source : text.split("\n")) {
+    if(auto position = source.find("//")) source.resize(position());  //remove comments
+
+    if(source[0] == '#') {
+      Line line;
+      line.command = source;
+      lines.append(line);
+      if(source == "#endian lsb" || source == "#endian msb" || source.find("#include ")) continue;
+    }
+
+    auto part = source.split(";", 1L).strip();
+    if(part.size() != 2) continue;
+
+    Line line;
+    line.opcode.text = {part(0), " ; ", part(1)};
+    assembleTableLHS(line.opcode, part(0));
+    assembleTableRHS(line.opcode, part(1));
+    lines.append(line);
+  }
+
+  lock_guard<mutex> lock(parsedLock);
+  if(!parsed.find(text)) parsed.insert(text, lines);
+  return parsed.find(text)();
+}
+
 // #directive <name> <byte_size>
 auto Table::parseDirective(string& line) -> void {
   auto work = line.strip();
@@ -1,8 +1,12 @@
 struct Table : Architecture {
   Table(Bass& self, const string& table);
   auto assemble(const string& statement) -> bool override;
+  auto aligned() const -> bool override { return bitpos == 0; }
+  auto clone() const -> Architecture* override { return new Table{*this}; }
+  auto encode(const vector<int64_t>& operands) -> void;
 
 private:
+
   struct Prefix {
     string text;
     uint size;
@@ -34,16 +38,41 @@ private:
     vector<Number> number;
     vector<Format> format;
     string pattern;
+    string text;  //table entry as written, for relocations
+  };
+
+  //a line of an architecture file: either a command, or an opcode
+  struct Line {
+    string command;
+    Opcode opcode;
+  };
+
+  struct Match {
+    const Opcode* opcode = nullptr;
+    string_vector args;  //operands, without their size hints
   };
 
+  auto match(const string& statement, const string& pattern) -> Match;
+  auto encode(const Opcode& opcode, const function<int64_t (uint)>& value, bool checked) -> void;
   auto bitLength(string& text) const -> uint;
+  auto valueLength(int64_t value) -> uint;
+  auto operand(const string& text, bool quiet) -> maybe<int64_t>;
   auto writeBits(uint64_t data, uint bits) -> void;
   auto parseTable(const string& text) -> bool;
+  auto parse(const string& text) -> const vector<Line>&;
   auto parseDirective(string& line) -> void;
   auto assembleTableLHS(Opcode& opcode, const string& text) -> void;
   auto assembleTableRHS(Opcode& opcode, const string& text) -> void;
   auto swapEndian(uint64_t data, unsigned bits) -> uint64_t;
 
-  vector<Opcode> table;
+  vector<const Opcode*> table;  //into parsed
+  static inline map<string, vector<Line>> parsed;  //architecture files by their contents, parsed once per process
+  static inline mutex parsedLock;
   uint64_t bitval, bitpos;
+
+  struct Value {
+    string text;
+    int64_t value;
+  };
+  vector<Value> values;  //operands of the current statement that have been evaluated
 };
@@ -6,6 +6,309 @@
 #include "core/core.cpp"
 #include "architecture/table/table.cpp"
 
+#if defined(PLATFORM_LINUX)
+  #include <sys/inotify.h>
+#endif
+
+//whether any of the inputs no longer has the stamp it was read with
+static auto modified(map<string, string>& inputs) -> bool {
+  for(auto& input : inputs) {
+    if(Bass::stamp(input.key) != input.value) return true;
+  }
+  return false;
+}
+
+//blocks until any of the inputs is modified, replaced or removed
+//their stamps are from before the assembly read them, so that changes made during it, or while the watches are being set up, are not missed
+static auto waitForChange(map<string, string>& inputs) -> void {
+  bool watching = false;
+  #if defined(PLATFORM_LINUX)
+  //directories are watched rather than the files themselves, as editors often save by replacing the file
+  int fd = inotify_init1(IN_CLOEXEC);
+  if(fd >= 0) {
+    map<int, string> directories;
+    for(auto& input : inputs) {
+      string path = Location::path(input.key);
+      if(!path) path = "./";
+      int wd = inotify_add_watch(fd, path, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+      if(wd >= 0) directories.insert(wd, path);
+    }
+    print(stderr, "bass: watching ", inputs.size(), " files\n");
+    watching = true;
+    bool changed = modified(inputs);
+    while(!changed) {
+      alignas(inotify_event) char buffer[4096];
+      auto length = read(fd, buffer, sizeof(buffer));
+      if(length <= 0) break;
+      for(char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + ((inotify_event*)p)->len) {
+        auto event = (inotify_event*)p;
+        if(!event->len) continue;
+        string path = directories.find(event->wd) ? directories.find(event->wd)() : string{};
+        for(auto& input : inputs) {
+          string location = Location::path(input.key) ? Location::path(input.key) : string{"./"};
+          if(location == path && Location::file(input.key) == event->name) changed = true;
+        }
+      }
+    }
+    //let editors finish writing before assembling again
+    pollfd pfd{fd, POLLIN};
+    while(poll(&pfd, 1, 50) > 0) {
+      char buffer[4096];
+      if(read(fd, buffer, sizeof(buffer)) <= 0) break;
+    }
+    close(fd);
+    if(changed) return;
+  }
+  #endif
+
+  //elsewhere, poll modification times
+  if(!watching) print(stderr, "bass: watching ", inputs.size(), " files\n");
+  while(!modified(inputs)) usleep(250'000);
+}
+
+//one assembly: the options and sources of the command line, or of one line of a -batch manifest
+struct Job {
+  string targetFilename;
+  bool create = false;
+  string baseFilename;
+  string patchBase;
+  string patchFilename;
+  string cacheDirectory;
+  string dependencyFilename;
+  string symbolFilename;
+  string objectFilename;
+  bool link = false;
+  vector<string> placements;
+  vector<string> defines;
+  vector<string> constants;
+  bool strict = false;
+  bool fixups = false;
+  bool relax = false;
+  bool benchmark = false;
+  uint threads = 0;  //for output files, and encoding only with -fixups (0 = one per processor)
+  vector<string> sourceFilenames;
+  string buildKey;   //identifies the build for -cache
+  shared_pointer<Bass::SourceCache> sources;  //lexed sources, shared by repeated assemblies (-watch, -batch)
+
+  bool buffered = false;  //diagnostics are kept in log, so that concurrent jobs do not interleave
+  string log;
+  bool succeeded = false;
+};
+
+//returns an error message when the options are invalid
+static auto parse(Arguments arguments, Job& job) -> string {
+  //identifies the build for -cache: the same command line in the same directory, with the same bass binary
+  Hash::SHA256 buildHash;
+  buildHash.input({"bass v18 ", __DATE__, " ", __TIME__, "\n", Path::active(), "\n"});
+  for(auto argument : arguments) buildHash.input({argument.trimRight("/", 1L), "\n"});  //directories gain a '/' once they exist
+  job.buildKey = buildHash.digest();
+
+  if(arguments.take("-o", job.targetFilename)) job.create = true;
+  if(arguments.take("-m", job.targetFilename)) job.create = false;
+
+  if(arguments.take("-b", job.baseFilename) && !job.targetFilename) {
+    return "-b requires a target specified with -o or -m";
+  }
+
+  if(arguments.take("-patch", job.patchBase, job.patchFilename) && job.targetFilename) {
+    return "-patch cannot be combined with -o or -m";
+  }
+
+  arguments.take("-cache", job.cacheDirectory);
+  arguments.take("-MD", job.dependencyFilename);
+  arguments.take("-sym", job.symbolFilename);
+
+  if(arguments.take("-obj", job.objectFilename) && (job.targetFilename || job.patchFilename)) {
+    return "-obj cannot be combined with -o, -m or -patch";
+  }
+
+  job.link = arguments.take("-link");
+  if(job.link && (!job.targetFilename || job.objectFilename)) {
+    return "-link requires a target specified with -o or -m";
+  }
+
+  string placement;
+  while(arguments.take("-section", placement)) job.placements.append(placement);
+
+  string define;
+  while(arguments.take("-d", define)) job.defines.append(define);
+
+  string constant;
+  while(arguments.take("-c", constant)) job.constants.append(constant);
+
+  job.strict = arguments.take("-strict");
+  job.fixups = arguments.take("-fixups");
+  job.relax = arguments.take("-relax");
+  job.benchmark = arguments.take("-benchmark");
+  string count;
+  if(arguments.take("-j", count)) job.threads = count.natural();
+
+  if(arguments.find("-*")) return "unrecognized argument(s)";
+
+  for(auto& argument : arguments) job.sourceFilenames.append(argument);
+  return {};
+}
+
+//with -watch, the previous assembly is kept in resident, and resumed from its last checkpoint before the first changed statement
+static auto build(Job& job, shared_pointer<Bass>& resident, map<string, string>& inputs, bool watch) -> bool {
+  auto report = [&](const string& message) {
+    if(job.buffered) job.log.append(message);
+    else print(stderr, message);
+  };
+
+  //processor time of this thread, as other jobs of a -batch may be running at the same time
+  auto clock = [] {
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec / 1'000'000'000.0;
+  };
+
+  double clockStart = clock();
+  maybe<bool> resumed;
+  if(resident) resumed = resident->reassemble();
+  if(!resumed) resident = new Bass;
+  Bass& bass = *resident;
+  if(job.sources) bass.sources(job.sources);
+  if(job.buffered) bass.diagnostics([&](const string& message) { job.log.append(message); });
+  auto finish = [&](bool succeeded) -> bool {
+    return job.succeeded = succeeded;
+  };
+
+  if(resumed && !resumed()) {
+    inputs = bass.stamps();
+    report("bass: assembly failed\n");
+    return finish(false);
+  }
+  bool cached = false;
+  if(!resumed) {
+    bass.cache(job.cacheDirectory);
+    cached = bass.restore(job.buildKey);
+    if(!cached && job.objectFilename) bass.object(job.objectFilename);
+    if(!cached && !job.objectFilename && !bass.target(job.targetFilename, job.create, job.baseFilename) && job.baseFilename) {
+      report("bass: assembly failed\n");
+      return finish(false);
+    }
+    if(!cached && job.patchFilename && !bass.patch(job.patchBase, job.patchFilename)) {
+      report("bass: assembly failed\n");
+      return finish(false);
+    }
+    if(!cached) {
+      bass.fixups(job.fixups);
+      bass.threads(job.threads);
+      if(job.relax) bass.relax();
+      bass.checkpoints(watch);
+      if(job.symbolFilename) bass.symbols(job.symbolFilename);
+      for(auto& sourceFilename : job.sourceFilenames) {
+        if(job.link) bass.link(sourceFilename);
+        else bass.source(sourceFilename);
+      }
+      for(auto& placement : job.placements) {
+        auto p = placement.split("=", 1L);
+        auto q = p(1).split(",", 1L);
+        bass.place(p(0), toNatural(q(0)), toInteger(q(1, "0")));
+      }
+      for(auto& define : job.defines) {
+        auto p = define.split("=", 1L);
+        bass.define(p(0), p(1));
+      }
+      for(auto& constant : job.constants) {
+        auto p = constant.split("=", 1L);
+        bass.constant(p(0), p(1, "1"));
+      }
+      bool assembled = bass.assemble(job.strict);
+      inputs = bass.stamps();
+      if(!assembled) {
+        report("bass: assembly failed\n");
+        return finish(false);
+      }
+      bass.store(job.buildKey);
+    }
+  }
+  if(job.dependencyFilename && !bass.dependencies(job.dependencyFilename)) {
+    report({"bass: unable to write dependency file: ", job.dependencyFilename, "\n"});
+    return finish(false);
+  }
+  inputs = bass.stamps();
+  double clockFinish = clock();
+  if(job.benchmark) {
+    string action = cached ? "restored from cache" : resumed ? "reassembled" : "assembled";
+    report({"bass: ", action, " in ", clockFinish - clockStart, " seconds\n"});
+  }
+  return finish(true);
+}
+
+//runs every line of the manifest as an independent job, on a pool of worker threads
+//architecture tables are shared between jobs, as they are in the same process, and lexed sources through one source cache
+//diagnostics are printed per job, in manifest order
+static auto batch(const string& manifest, const vector<string>& common, uint workers) -> bool {
+  if(!file::exists(manifest)) {
+    print(stderr, "error: manifest not found: ", manifest, "\n");
+    return false;
+  }
+
+  vector<Job> jobs;
+  vector<string> names;  //location of each job in the manifest
+  shared_pointer<Bass::SourceCache> sources = new Bass::SourceCache;
+  auto lines = string::read(manifest).split("\n");
+  for(uint lineNumber : range(lines.size())) {
+    auto line = lines[lineNumber].strip();
+    if(!line || line.beginsWith("#")) continue;
+    vector<string> arguments{"bass"};
+    for(auto& argument : common) arguments.append(argument);
+    for(auto& argument : line.qsplit(" ")) {
+      if(argument.strip()) arguments.append(argument.trim("\"", "\"", 1L));
+    }
+    Job job;
+    job.buffered = true;
+    job.threads = 1;  //jobs already run in parallel
+    job.sources = sources;
+    if(auto message = parse(Arguments{arguments}, job)) job.log = {"error: ", message, "\n"};
+    jobs.append(job);
+    names.append({manifest, ":", 1 + lineNumber});
+  }
+
+  if(!workers) workers = std::thread::hardware_concurrency();
+  workers = max(1u, min(workers, jobs.size()));
+
+  atomic<uint> next{0};
+  mutex reporting;
+  vector<bool> finished;
+  finished.resize(jobs.size());
+  uint reported = 0;
+  auto worker = [&](uintptr) {
+    while(true) {
+      uint n = next++;
+      if(n >= jobs.size()) break;
+      auto& job = jobs[n];
+      if(!job.log) {
+        shared_pointer<Bass> resident;
+        map<string, string> inputs;
+        build(job, resident, inputs, false);
+      }
+
+      //print the diagnostics of every job finished so far, in order
+      lock_guard<mutex> lock(reporting);
+      finished[n] = true;
+      while(reported < jobs.size() && finished[reported]) {
+        auto& job = jobs[reported];
+        print(stderr, job.log);
+        if(!job.succeeded) print(stderr, "bass: ", names[reported], ": job failed\n");
+        reported++;
+      }
+    }
+  };
+
+  vector<thread> threads;
+  for(uint n : range(workers - 1)) threads.append(thread::create(worker));
+  worker(0);
+  for(auto& thread : threads) thread.join();
+
+  uint failed = 0;
+  for(auto& job : jobs) if(!job.succeeded) failed++;
+  if(failed) print(stderr, "bass: ", failed, " of ", jobs.size(), " jobs failed\n");
+  return !failed;
+}
+
 #include <nall/main.hpp>
 auto nall::main(Arguments arguments) -> void {
   if(!arguments) {
@@ -13,61 +316,74 @@ auto nall::main(Arguments arguments) -> void {
     print(stderr, "\n");
     print(stderr, "usage:\n");
     print(stderr, "  bass [options] source [source ...]\n");
+    print(stderr, "  bass -obj object [options] source [source ...]\n");
+    print(stderr, "  bass -link -o target [-section name=offset[,base] ...] object [object ...]\n");
+    print(stderr, "  bass -batch manifest [-j count] [options]\n");
     print(stderr, "\n");
     print(stderr, "options:\n");
     print(stderr, "  -o target        specify default output filename [overwrite]\n");
     print(stderr, "  -m target        specify default output filename [modify]\n");
+    print(stderr, "  -b base          start target from a copy of base image [modify]\n");
+    print(stderr, "  -patch base out  write changes against base as BPS (or IPS) patch\n");
+    print(stderr, "  -cache directory reuse outputs and compressed inserts\n");
+    print(stderr, "  -MD depfile      write a make rule listing all input files\n");
+    print(stderr, "  -sym symbols     write constants and regions for use with import\n");
+    print(stderr, "  -obj object      assemble into a relocatable object file\n");
+    print(stderr, "  -link            link object files into the target\n");
+    print(stderr, "  -section n=o[,b] place linked section n at file offset o [, base b]\n");
     print(stderr, "  -d name[=value]  create define with optional value\n");
     print(stderr, "  -c name[=value]  create constant with optional value\n");
     print(stderr, "  -strict          upgrade warnings to errors\n");
+    print(stderr, "  -fixups          write in the Query phase, then fix up forward references\n");
+    print(stderr, "  -relax           repeat Query phase to pick encodings by operand size\n");
+    print(stderr, "  -watch           assemble again whenever an input file changes\n");
+    print(stderr, "  -batch manifest  run each line of manifest as a separate assembly\n");
+    print(stderr, "  -j count         threads for -batch, output files and (only with -fixups) encoding [all cores]\n");
     print(stderr, "  -benchmark       benchmark performance\n");
     exit(EXIT_FAILURE);
   }
 
-  string targetFilename;
-  bool create = false;
-  if(arguments.take("-o", targetFilename)) create = true;
-  if(arguments.take("-m", targetFilename)) create = false;
-
-  vector<string> defines;
-  string define;
-  while(arguments.take("-d", define)) defines.append(define);
-
-  vector<string> constants;
-  string constant;
-  while(arguments.take("-c", constant)) constants.append(constant);
+  bool watch = arguments.take("-watch");
 
-  bool strict = arguments.take("-strict");
-  bool benchmark = arguments.take("-benchmark");
+  //the remaining options apply to every job of the manifest
+  string manifest;
+  if(arguments.take("-batch", manifest)) {
+    if(watch) {
+      print(stderr, "error: -batch cannot be combined with -watch\n");
+      exit(EXIT_FAILURE);
+    }
+    string count;
+    uint workers = arguments.take("-j", count) ? count.natural() : 0;
+    vector<string> common;
+    for(auto& argument : arguments) common.append(argument);
+    if(!batch(manifest, common, workers)) exit(EXIT_FAILURE);
+    return;
+  }
 
-  if(arguments.find("-*")) {
-    print(stderr, "error: unrecognized argument(s)\n");
+  Job job;
+  if(auto message = parse(arguments, job)) {
+    print(stderr, "error: ", message, "\n");
     exit(EXIT_FAILURE);
   }
 
-  vector<string> sourceFilenames;
-  for(auto& argument : arguments) sourceFilenames.append(argument);
-
-  clock_t clockStart = clock();
-  Bass bass;
-  bass.target(targetFilename, create);
-  for(auto& sourceFilename : sourceFilenames) {
-    bass.source(sourceFilename);
-  }
-  for(auto& define : defines) {
-    auto p = define.split("=", 1L);
-    bass.define(p(0), p(1));
+  map<string, string> inputs;
+  shared_pointer<Bass> resident;
+  if(!watch) {
+    if(!build(job, resident, inputs, false)) exit(EXIT_FAILURE);
+    return;
   }
-  for(auto& constant : constants) {
-    auto p = constant.split("=", 1L);
-    bass.constant(p(0), p(1, "1"));
-  }
-  if(!bass.assemble(strict)) {
-    print(stderr, "bass: assembly failed\n");
-    exit(EXIT_FAILURE);
-  }
-  clock_t clockFinish = clock();
-  if(benchmark) {
-    print(stderr, "bass: assembled in ", (double)(clockFinish - clockStart) / CLOCKS_PER_SEC, " seconds\n");
+
+  //lexed sources are kept in memory, so only files that changed are lexed again
+  job.sources = new Bass::SourceCache;
+  //assemblies resume from checkpoints of the previous one when only sources changed
+  while(true) {
+    //sources that could not be read are watched too, with their stamps from before the assembly looked for them
+    map<string, string> sources;
+    for(auto& sourceFilename : job.sourceFilenames) sources.insert(sourceFilename, Bass::stamp(sourceFilename));
+    build(job, resident, inputs, true);
+    for(auto& source : sources) {
+      if(!inputs.find(source.key)) inputs.insert(source.key, source.value);
+    }
+    waitForChange(inputs);
   }
 }
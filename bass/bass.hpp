@@ -1,9 +1,12 @@
 #define Architecture NallArchitecture
 #include <nall/nall.hpp>
+#include <nall/encode/lzsa.hpp>
+#include <thread>
 using namespace nall;
 using string_vector = vector<string>;
 #undef Architecture
 
+#include "core/image.hpp"
 #include "core/core.hpp"
 #include "architecture/architecture.hpp"
 #include "architecture/table/table.hpp"
@@ -130,5 +130,33 @@ auto Bass::analyzeInstruction(Instruction& i) -> bool {
     return true;
   }
 
+  if(s.match("for ?* {")) {
+    blocks.append({ip - 1, "for"});
+    return true;
+  }
+
+  if(s.match("}") && blocks.right().type == "for") {
+    uint rp = blocks.right().ip;
+    program[rp].ip = ip;
+    blocks.removeRight();
+    i.statement = "} endfor";
+    i.ip = rp + 1;
+    return true;
+  }
+
+  if(s.match("repeat ?* {")) {
+    blocks.append({ip - 1, "repeat"});
+    return true;
+  }
+
+  if(s.match("}") && blocks.right().type == "repeat") {
+    uint rp = blocks.right().ip;
+    program[rp].ip = ip;
+    blocks.removeRight();
+    i.statement = "} endrepeat";
+    i.ip = rp + 1;
+    return true;
+  }
+
   return true;
 }
@@ -7,6 +7,19 @@ auto Bass::initialize() -> void {
   base = 0;
   lastLabelCounter = 1;
   nextLabelCounter = 1;
+  tracker.enable = false;
+  if(emitting()) regions.reset();
+
+  if(objectFilename) {
+    if(!sections) sections.append({"text"});
+    for(auto& section : sections) {
+      section.origin = 0;
+      section.base = 0;
+      if(writePhase()) section.data.reset();
+    }
+    sectionIndex = 0;
+    if(writePhase()) relocations.reset();
+  }
 }
 
 auto Bass::assemble(const string& statement) -> bool {
@@ -32,7 +45,7 @@ auto Bass::assemble(const string& statement) -> bool {
   //function name {
   if(s.match("function ?* {")) {
     s.trim("function ", "{", 1L).strip();
-    setConstant(s, pc());
+    setConstant(s, pc(), pcGroup());
     scope.append(s);
     return true;
   }
@@ -46,7 +59,10 @@ auto Bass::assemble(const string& statement) -> bool {
   //constant name(value)
   if(s.match("constant ?*")) {
     auto p = s.trimLeft("constant ", 1L).split("=", 1L).strip();
-    setConstant(p(0), evaluate(p(1)));
+    auto value = reference(p(1));
+    //constants are relocated with their value, which a shift or mask would not follow
+    if(!value.linear()) error("expression cannot be relocated: ", p(1));
+    setConstant(p(0), value.value, value.group);
     return true;
   }
 
@@ -54,19 +70,19 @@ auto Bass::assemble(const string& statement) -> bool {
   if(s.match("?*:") || s.match("?*: {")) {
     s.trimRight(" {", 1L);
     s.trimRight(":", 1L);
-    setConstant(s, pc());
+    setConstant(s, pc(), pcGroup());
     return true;
   }
 
   //- or - {
   if(s.match("-") || s.match("- {")) {
-    setConstant({"lastLabel#", lastLabelCounter++}, pc());
+    setConstant({"lastLabel#", lastLabelCounter++}, pc(), pcGroup());
     return true;
   }
 
   //+ or + {
   if(s.match("+") || s.match("+ {")) {
-    setConstant({"nextLabel#", nextLabelCounter++}, pc());
+    setConstant({"nextLabel#", nextLabelCounter++}, pc(), pcGroup());
     return true;
   }
 
@@ -75,12 +91,56 @@ auto Bass::assemble(const string& statement) -> bool {
     return true;
   }
 
+  //section name [, align]
+  if(s.match("section ?*")) {
+    if(!objectFilename) error("sections require an object file (-obj)");
+    auto p = split(s.trimLeft("section ", 1L));
+    int64_t align = p.size() > 1 ? evaluate(p(1), Evaluation::Strict) : 1;
+    if(align <= 0 || (align & align - 1)) error("section alignment must be a power of two: ", align);
+    if(!validate(p(0))) error("invalid section name: ", p(0));
+    selectSection(p(0), align);
+    return true;
+  }
+
+  //extern name [, ...]
+  if(s.match("extern ?*")) {
+    if(!objectFilename) error("externs require an object file (-obj)");
+    for(auto& name : split(s.trimLeft("extern ", 1L))) {
+      auto index = externs.find(name);
+      if(!index) externs.append(name), index = externs.size() - 1;
+      if(findConstant(name) && !relocatables.find({name})) error("extern is already defined: ", name);
+      if(!findConstant(name)) setConstant(name, 0, -2 - (int)index());
+    }
+    return true;
+  }
+
+  //export name [, ...]
+  if(s.match("export ?*")) {
+    if(!objectFilename) error("exports require an object file (-obj)");
+    for(auto& name : split(s.trimLeft("export ", 1L))) {
+      if(!validate(name)) error("invalid export identifier: ", name);
+      exports.insert({scope.merge("."), scope ? "." : "", name});
+    }
+    return true;
+  }
+
   //output "filename" [, create]
   if(s.match("output ?*")) {
     auto p = split(s.trimLeft("output ", 1L));
     if(!p(0).match("\"*\"")) error("missing filename");
     string filename = {filepath(), text(p.take(0))};
     bool create = (p.size() && p(0) == "create");
+    checkpointing = false;  //reassemble() only tracks a single target
+    undefer();  //the fixups are written to a single target
+    if(queryPhase()) recordOutput(filename, create);
+    if(writePhase() && segmenting) {
+      if(!segmentOutputs) {
+        segmentEnded = true;
+        ip--;
+        return true;
+      }
+      segmentOutputs--;
+    }
     target(filename, create);
     return true;
   }
@@ -94,6 +154,7 @@ auto Bass::assemble(const string& statement) -> bool {
     else {
       architecture = new Table{*this, readArchitecture(s)};
     }
+    architectureName = s;
     return true;
   }
 
@@ -171,12 +232,30 @@ auto Bass::assemble(const string& statement) -> bool {
       targetFile.seek(source);
       targetFile.read(memory);
       targetFile.seek(target);
-      for(uint offset : range(length)) write(memory[offset]);
+      writeBlock(memory);
       targetFile.seek(origin);
       return true;
     }
   }
 
+  //import "filename"
+  if(s.match("import ?*")) {
+    s.trimLeft("import ", 1L).strip();
+    importSymbols({filepath(), text(s)});
+    return true;
+  }
+
+  //region offset, length
+  if(s.match("region ?*")) {
+    auto p = split(s.trimLeft("region ", 1L));
+    if(p.size() != 2) error("invalid region directive");
+    Region region;
+    region.offset = evaluate(p(0));
+    region.length = evaluate(p(1));
+    if(emitting() && targetFile) regions.append(region);
+    return true;
+  }
+
   //insert [name, ] filename [, offset] [, length]
   if(s.match("insert ?*")) {
     auto p = split(s.trimLeft("insert ", 1L));
@@ -184,18 +263,48 @@ auto Bass::assemble(const string& statement) -> bool {
     if(!p(0).match("\"*\"")) name = p.take(0);
     if(!p(0).match("\"*\"")) error("missing filename");
     string filename = {filepath(), text(p.take(0))};
-    auto fp = file::open(filename, file::mode::read);
+    depend(filename);
+    auto fp = openInput(filename);
     if(!fp) error("file not found: ", filename);
     uint offset = p.size() ? evaluate(p.take(0)) : 0;
     if(offset > fp.size()) offset = fp.size();
     uint length = p.size() ? evaluate(p.take(0)) : 0;
     if(length == 0) length = fp.size() - offset;
     if(name) {
-      setConstant({name}, pc());
+      setConstant({name}, pc(), pcGroup());
       setConstant({name, ".size"}, length);
     }
-    fp.seek(offset);
-    while(!fp.end() && length--) write(fp.read());
+    length = min(length, fp.size() - offset);
+    if(!emitting()) {
+      origin += length;
+      return true;
+    }
+    writeBlock({fp.data() + offset, length});
+    return true;
+  }
+
+  //insert.codec [name, ] filename [, offset] [, length]
+  if(s.match("insert.?* ?*")) {
+    auto codec = s.trimLeft("insert.", 1L).split(" ", 1L);
+    auto p = split(codec(1));
+    string name;
+    if(!p(0).match("\"*\"")) name = p.take(0);
+    if(!p(0).match("\"*\"")) error("missing filename");
+    string filename = {filepath(), text(p.take(0))};
+    depend(filename);
+    auto fp = openInput(filename);
+    if(!fp) error("file not found: ", filename);
+    uint offset = p.size() ? evaluate(p.take(0)) : 0;
+    if(offset > fp.size()) offset = fp.size();
+    uint length = p.size() ? evaluate(p.take(0)) : 0;
+    if(length == 0) length = fp.size() - offset;
+    length = min(length, fp.size() - offset);
+    auto data = compress(codec(0), {fp.data() + offset, length});
+    if(name) {
+      setConstant({name}, pc(), pcGroup());
+      setConstant({name, ".size"}, data.size());
+    }
+    writeBlock(data);
     return true;
   }
 
@@ -204,6 +313,8 @@ auto Bass::assemble(const string& statement) -> bool {
     auto p = split(s.trimLeft("delete ", 1L));
     if(!p(0).match("\"*\"")) error("missing filename");
     string filename = {filepath(), text(p.take(0))};
+    cacheable = false;
+    independentOutputs = false;  //the file could be one of the outputs
     if(!file::exists(filename)) {
       warning("file not found: ", filename);
       return true;
@@ -220,7 +331,57 @@ auto Bass::assemble(const string& statement) -> bool {
     auto p = split(s.trimLeft("fill ", 1L));
     uint length = evaluate(p(0));
     uint byte = evaluate(p(1, "0"));
-    while(length--) write(byte);
+    fillBlock(byte, length);
+    return true;
+  }
+
+  //table d[bwldq], count, expression
+  if(s.match("table ?*")) {
+    auto p = split(s.trimLeft("table ", 1L));
+    if(p.size() != 3) error("table requires a data directive, count and expression");
+    uint dataLength = 0;
+    for(auto& d : directives.EmitBytes) {
+      if(d.token == string{p(0), " "}) dataLength = d.dataLength;
+    }
+    if(!dataLength) error("unrecognized data directive: ", p(0));
+    int64_t count = evaluate(p(1), Evaluation::Strict);
+    if(count < 0) error("table count cannot be negative: ", count);
+    //origin is a 32-bit file offset, which the table must not run past
+    if(count > (0x1'0000'0000 - origin) / dataLength) error("table does not fit in the target: ", count, " entries");
+
+    //table contents cannot affect layout, so only the write phase needs to evaluate them
+    if(!emitting()) {
+      origin += count * dataLength;
+      return true;
+    }
+
+    //the expression is parsed once, then evaluated for each index i = 0 .. count-1
+    //entries are written in blocks, so that the buffer stays small however large the table is
+    auto node = parse(p(2));
+    frames.append({0, true});
+    try {
+      uint block = 65536 / dataLength * dataLength;
+      vector<uint8_t> buffer;
+      buffer.reserve(block);
+      for(int64_t n : range(count)) {
+        setVariable("i", n, Frame::Level::Inline);
+        uint64_t data = evaluate(node, Evaluation::Default);
+        for(uint byte : range(dataLength)) buffer.append(data >> byte * 8);
+        origin += dataLength;
+        if(buffer.size() < block) continue;
+        origin -= buffer.size();
+        writeBlock(buffer, dataLength);
+        buffer.resize(0);
+      }
+      origin -= buffer.size();
+      writeBlock(buffer, dataLength);
+    } catch(...) {
+      frames.removeRight();
+      delete node;
+      throw;
+    }
+    frames.removeRight();
+    delete node;
     return true;
   }
 
@@ -249,15 +410,17 @@ auto Bass::assemble(const string& statement) -> bool {
   }
   if(dataLength) {
     s = slice(s, tokenLength);  //remove prefix +space
-    auto p = split(s);
-    for(auto& t : p) {
-      if(t.match("\"*\"")) {
-        t = text(t);
-        for(auto& b : t) write(stringTable[b], dataLength);
-      } else {
-        write(evaluate(t), dataLength);
-      }
+    if(!deferring) {
+      assembleData(s, dataLength);
+      return true;
     }
+    //recorded like an instruction, so that forward references can be fixed up by the Write phase
+    Encoding e{s, origin, base, endian, architectureName, lastLabelCounter, nextLabelCounter, scope.merge(".")};
+    e.dataLength = dataLength;
+    encoding = &e;
+    assembleData(s, dataLength);
+    encoding = nullptr;
+    if(e.forward) recordFixup(e);
     return true;
   }
 
@@ -272,32 +435,59 @@ auto Bass::assemble(const string& statement) -> bool {
   //tracker enable|disable|reset
   if(s.match("tracker ?*")) {
     s.trimLeft("tracker ", 1L).strip();
+    //followed by the Query phase as well, so that its state matches that of the Write phase (see writeOutputs())
     if(s == "enable") {
-      if(writePhase()) tracker.enable = true;
+      tracker.enable = true;
       return true;
     }
     if(s == "disable") {
-      if(writePhase()) tracker.enable = false;
+      tracker.enable = false;
       return true;
     }
     if(s == "reset") {
-      if(writePhase()) tracker.addresses.reset();
+      if(emitting()) tracker.reset();
       return true;
     }
   }
 
+  //checksum snes [, address]
+  //checksum n64 [, cic]
+  //checksum crc32, address, offset, length
+  if(s.match("checksum ?*")) {
+    auto p = split(s.trimLeft("checksum ", 1L));
+    Checksum checksum{};
+    checksum.endian = endian;
+    if(p(0) == "snes") {
+      checksum.type = Checksum::Type::SNES;
+      checksum.address = evaluate(p(1, "0x7fdc"));
+    } else if(p(0) == "n64") {
+      checksum.type = Checksum::Type::N64;
+      checksum.cic = evaluate(p(1, "6102"));
+      if(checksum.cic < 6101 || checksum.cic > 6106 || checksum.cic == 6104) error("unsupported CIC: ", checksum.cic);
+    } else if(p(0) == "crc32" && p.size() == 4) {
+      checksum.type = Checksum::Type::CRC32;
+      checksum.address = evaluate(p(1));
+      checksum.offset = evaluate(p(2));
+      checksum.length = evaluate(p(3));
+    } else {
+      error("invalid checksum directive");
+    }
+    if(emitting() && targetFile) checksums.append(checksum);
+    return true;
+  }
+
   //print ("string"|[cast:]variable) [, ...]
   if(s.match("print ?*")) {
-    if(writePhase()) {
+    if(emitting()) {
       s.trimLeft("print ", 1L).strip();
-      print(stderr, assembleString(s));
+      report(assembleString(s));
     }
     return true;
   }
 
   //notice ("string"|[cast:]variable) [, ...]
   if(s.match("notice ?*")) {
-    if(writePhase()) {
+    if(emitting()) {
       s.trimLeft("notice ", 1L).strip();
       notice(assembleString(s));
     }
@@ -306,7 +496,7 @@ auto Bass::assemble(const string& statement) -> bool {
 
   //warning ("string"|[cast:]variable) [, ...]
   if(s.match("warning ?*")) {
-    if(writePhase()) {
+    if(emitting()) {
       s.trimLeft("warning ", 1L).strip();
       warning(assembleString(s));
     }
@@ -315,7 +505,7 @@ auto Bass::assemble(const string& statement) -> bool {
 
   //error ("string"|[cast:]variable) [, ...]
   if(s.match("error ?*")) {
-    if(writePhase()) {
+    if(emitting()) {
       s.trimLeft("error ", 1L).strip();
       error(assembleString(s));
     }
@@ -323,11 +513,85 @@ auto Bass::assemble(const string& statement) -> bool {
   }
 
   charactersUseMap = true;
-  bool result = architecture->assemble(statement);
+  bool result = assembleInstruction(statement);
   charactersUseMap = false;
   return result;
 }
 
+//with fixups enabled, the Query phase records the bytes of each instruction along with everything they were computed from
+//the Write phase then only assembles instructions that evaluated forward references, or whose inputs have since changed
+//the first instruction that differs from the recording means control flow diverged, and all later instructions are assembled
+//while deferring, the Query phase writes every instruction itself, and records only those that evaluated forward references
+auto Bass::assembleInstruction(const string& statement) -> bool {
+  if(statement.match("instrument \"*\"")) {
+    architectureName.append("\n", statement);
+    return architecture->assemble(statement);
+  }
+  //relocations are only recorded when the instruction is encoded
+  if(!reuseEncodings || objectFilename || !architecture->aligned()) return architecture->assemble(statement);
+
+  if(writePhase()) {
+    if(encodingIndex >= encodings.size()) return architecture->assemble(statement);
+    auto& e = encodings[encodingIndex++];
+    if(e.statement != statement || e.origin != origin || e.base != base || e.endian != endian
+    || e.architecture != architectureName) {
+      encodingIndex = encodings.size();
+      return architecture->assemble(statement);
+    }
+    bool reusable = e.reusable && !e.forward && e.lastLabelCounter == lastLabelCounter && e.nextLabelCounter == nextLabelCounter;
+    for(auto& input : e.inputs) {
+      if(!reusable) break;
+      if(auto variable = findVariable(input.name)) reusable = variable().value == input.value;
+      else if(auto constant = findConstant(input.name)) reusable = constant().value == input.value;
+      else reusable = false;
+    }
+    if(!reusable) return architecture->assemble(statement);
+    writeBlock(e.data);
+    return true;
+  }
+
+  Encoding e{statement, origin, base, endian, architectureName, lastLabelCounter, nextLabelCounter, scope.merge(".")};
+  encoding = &e;
+  bool result = architecture->assemble(statement);
+  encoding = nullptr;
+  //statements the table did not match (assignments, asserts) are recorded only to keep the Write phase in step
+  if(!result) e.reusable = false;
+  if(!architecture->aligned()) e.reusable = false;  //the encoding ends with bits that have not been written yet
+  if(deferring) {
+    if(e.forward) recordFixup(e);
+    return result;
+  }
+  encodings.append(move(e));
+  return result;
+}
+
+//d[bwldq] operands, each value dataLength bytes
+auto Bass::assembleData(const string& operands, uint dataLength) -> void {
+  auto p = split(operands);
+  vector<uint8_t> buffer;
+  auto append = [&](uint64_t data) {
+    for(uint n : range(dataLength)) buffer.append(data >> n * 8);
+    origin += dataLength;  //keep pc() current for the operands that follow
+  };
+  for(auto& t : p) {
+    if(t.match("\"*\"")) {
+      if(encoding) encoding->reusable = false;  //the string table may differ by then
+      t = text(t);
+      for(auto& b : t) append(stringTable[b]);
+    } else if(auto value = decodeLiteral(t)) {
+      append(value());
+    } else {
+      auto operand = reference(t);
+      if(operand.group != Reference::Absolute && writePhase()) {
+        relocations.append({sectionIndex, origin, (int)pc(), endian, dataLength, {}, {operand}});
+      }
+      append(operand.value);
+    }
+  }
+  origin -= buffer.size();
+  writeBlock(buffer, dataLength);
+}
+
 auto Bass::assembleString(const string& parameters) -> string {
   string result;
   auto p = split(parameters);
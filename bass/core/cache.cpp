@@ -0,0 +1,86 @@
+//whole-build cache
+//key identifies a build by everything known before assembly starts (bass version, command line, working directory)
+//its manifest records the hash of every input that build read, and the hash of every file it wrote
+//along with the diagnostics and print output of the build, which are then reported again
+//when all inputs still match, the outputs are copied out of the cache instead of assembling again
+
+auto Bass::restore(const string& key) -> bool {
+  if(!cacheDirectory) return false;
+  string manifest = string::read({cacheDirectory, key, ".build"});
+  if(!manifest) return false;
+
+  set<string> inputs, outputs;
+  map<string, string> stamps;
+  vector<std::pair<string, string>> copies;
+  string log;
+  for(auto& line : manifest.split("\n")) {
+    auto p = line.split(" ", 2L);
+    if(p(0) == "log" && p.size() == 2) {
+      string blob = {cacheDirectory, p[1]};
+      if(!file::exists(blob)) return false;
+      log = string::read(blob);
+    }
+    if(p.size() != 3) continue;
+    if(p[0] == "input") {
+      string before = stamp(p[2]);
+      if(p[1] != digest(p[2])) return false;
+      inputs.insert(p[2]);
+      stamps.insert(p[2], before);
+    }
+    if(p[0] == "output") {
+      string blob = {cacheDirectory, p[1]};
+      if(!file::exists(blob)) return false;
+      copies.append({blob, p[2]});
+      outputs.insert(p[2]);
+    }
+  }
+  if(!outputs) return false;
+
+  for(auto& [blob, filename] : copies) {
+    file::remove(filename);
+    if(!file::copy(blob, filename)) return false;
+  }
+  inputFilenames = inputs;
+  readStamps = stamps;
+  targetFilenames = outputs;
+  if(log) report(log);
+  return true;
+}
+
+//only builds whose outputs are fully determined by their inputs are stored
+auto Bass::store(const string& key) -> bool {
+  if(!cacheDirectory || !cacheable || !targetFilenames) return false;
+  if(!directory::create(cacheDirectory)) return false;
+
+  //entries are written under a temporary name first, so concurrent builds never read a partial entry
+  string temporary = {".", getpid(), ".", hex((uintptr)this)};
+  string manifest;
+  for(auto& filename : inputFilenames) manifest.append("input ", digest(filename), " ", filename, "\n");
+  for(auto& filename : targetFilenames) {
+    string hash = digest(filename);
+    string blob = {cacheDirectory, hash};
+    if(!file::exists(blob)) {
+      if(!file::copy(filename, {blob, temporary})) return false;
+      file::move({blob, temporary}, blob);
+    }
+    manifest.append("output ", hash, " ", filename, "\n");
+  }
+  if(diagnosticLog) {
+    string hash = Hash::SHA256(diagnosticLog).digest();
+    string blob = {cacheDirectory, hash};
+    if(!file::exists(blob)) {
+      if(!file::write({blob, temporary}, diagnosticLog)) return false;
+      file::move({blob, temporary}, blob);
+    }
+    manifest.append("log ", hash, "\n");
+  }
+  string filename = {cacheDirectory, key, ".build"};
+  if(!file::write({filename, temporary}, manifest)) return false;
+  return file::move({filename, temporary}, filename);
+}
+
+//files that were probed for but did not exist are recorded as such
+auto Bass::digest(const string& filename) -> string {
+  if(!file::exists(filename)) return "missing";
+  return file::sha256(filename);
+}
@@ -0,0 +1,375 @@
+//incremental reassembly (see -watch)
+//execution state is copied at checkpoints between top-level statements, roughly every Checkpoint::Interval statements;
+//constant changes are journaled, and the target image journals each page before its first write after a checkpoint.
+//once sources change, reassemble() undoes everything past the last checkpoint preceding the first changed statement,
+//and resumes both phases from there. the Query phase switches back to the results of the previous assembly as soon as
+//it reaches a checkpoint of the previous run in the unchanged tail of the program with exactly the same state
+
+auto Bass::reassemble() -> maybe<bool> {
+  if(!resumable) return nothing;
+  resumable = false;
+
+  //inserted files, architectures and the target itself must be as they were
+  //those that are not read again keep the stamps they were read with
+  readStamps.reset();
+  for(auto& input : inputStamps) {
+    if(stamp(input.key) != input.value) return nothing;
+    if(input.key != targetName) readStamps.insert(input.key, input.value);
+  }
+
+  auto previous = move(program);
+  program.reset();
+  sourceFilenames.reset();
+  for(auto& filename : rootFilenames) {
+    if(!include(filename)) return nothing;
+  }
+
+  try {
+    phase = Phase::Analyze;
+    analyze();
+
+    //statements are compared after analysis, which rewrites block statements to match their opening statement
+    uint prefix = 0, suffix = 0;
+    uint common = min(previous.size(), program.size());
+    while(prefix < common && previous[prefix].statement == program[prefix].statement) prefix++;
+    while(suffix < common - prefix
+    && previous[previous.size() - 1 - suffix].statement == program[program.size() - 1 - suffix].statement) suffix++;
+    if(prefix == previous.size() && prefix == program.size()) {
+      record();
+      return true;
+    }
+
+    //a checkpoint can be resumed from when every statement executed before it precedes the first change
+    auto latest = [&](const vector<Checkpoint>& checkpoints) -> maybe<uint> {
+      maybe<uint> index;
+      for(uint n : range(checkpoints.size())) {
+        if(checkpoints[n].reach <= prefix) index = n;
+      }
+      return index;
+    };
+
+    auto previousJournal = journal;
+    auto previousQueryJournal = queryJournal;
+    activeInstruction = nullptr;
+
+    phase = Phase::Query;
+    converge(previous, prefix, suffix);
+    if(auto index = latest(queryCheckpoints)) {
+      auto& checkpoint = queryCheckpoints[index()];
+      undo(checkpoint.journal);
+      convergence.journalStart = checkpoint.journal;
+      encodings.resize(checkpoint.encodings);
+      resume(checkpoint);
+      queryCheckpoints.resize(index() + 1);
+      run();
+      frames.reset();
+    } else {
+      undo(0);
+      convergence.journalStart = 0;
+      architecture = new Architecture{*this};
+      queryCheckpoints.reset();
+      execute();
+    }
+    converging = false;
+    convergence = {};
+    queryJournal = journal.size();
+
+    //the Write phase can only be resumed when the Query phase produced the same constants as before
+    bool unchanged = queryJournal == previousQueryJournal;
+    if(unchanged) {
+      hashset<Constant> previousConstants;
+      for(uint64_t n : range(previousQueryJournal)) {
+        previousConstants.insert({previousJournal[n].name, previousJournal[n].value});
+      }
+      for(uint64_t n : range(queryJournal)) {
+        auto constant = previousConstants.find({journal[n].name});
+        if(!constant || constant().value != journal[n].value) { unchanged = false; break; }
+      }
+    }
+
+    phase = Phase::Write;
+    maybe<uint> index;
+    if(unchanged) index = latest(writeCheckpoints);
+    if(index && targetFile.open(targetName, false)) {
+      auto& checkpoint = writeCheckpoints[index()];
+      for(uint64_t n = queryJournal; n < checkpoint.journal; n++) {
+        auto& change = previousJournal[n];
+        if(auto constant = constants.find({change.name})) constant().value = change.value;
+        else constants.insert({change.name, change.value});
+        journal.append(change);
+      }
+      targetFile.rollback(checkpoint.image, checkpoint.imageSize);
+      targetFile.seek(checkpoint.position);
+      tracker.reset();
+      tracker.enable = false;
+      encodingIndex = checkpoint.diverged ? encodings.size() : checkpoint.encodings;
+      resume(checkpoint);
+      writeCheckpoints.resize(index() + 1);
+      run();
+      frames.reset();
+    } else {
+      if(!targetFile.open(targetName, true)) error("unable to open target file: ", targetName);
+      targetFile.journal(true);
+      tracker.reset();
+      architecture = new Architecture{*this};
+      writeCheckpoints.reset();
+      execute();
+    }
+    closeTarget();
+    if(symbolFilename) writeSymbols();
+  } catch(...) {
+    converging = false;
+    convergence = {};
+    return false;
+  }
+
+  record();
+  return true;
+}
+
+auto Bass::Convergence::translate(uint ip) const -> maybe<uint> {
+  if(ip < prefix) return ip;
+  if(ip >= previousSize - suffix && ip <= previousSize) return ip - previousSize + size;
+  return nothing;
+}
+
+//prepares the resumed Query phase to look for the checkpoints of the previous one
+//only checkpoints in the unchanged tail of the program that are not inside any block qualify,
+//as execution could otherwise still return to changed statements (eg the start of an enclosing while loop)
+auto Bass::converge(const vector<Instruction>& previous, uint prefix, uint suffix) -> void {
+  convergence = {};
+  convergence.prefix = prefix;
+  convergence.suffix = suffix;
+  convergence.previousSize = previous.size();
+  convergence.size = program.size();
+  convergence.candidates.resize(program.size());
+
+  uint depth = 0;
+  vector<bool> topLevel;
+  for(auto& instruction : program) {
+    if(instruction.statement.beginsWith("}") && depth) depth--;
+    topLevel.append(depth == 0);
+    if(instruction.statement.endsWith("{")) depth++;
+  }
+
+  for(auto& candidate : convergence.candidates) candidate = -1;
+  for(uint n : range(queryCheckpoints.size())) {
+    auto& checkpoint = queryCheckpoints[n];
+    if(checkpoint.ip < previous.size() - suffix) continue;
+    auto ip = convergence.translate(checkpoint.ip);
+    if(!ip || ip() >= program.size() || !topLevel[ip()]) continue;
+    if(convergence.candidates[ip()] < 0) convergence.candidates[ip()] = n;
+  }
+
+  convergence.checkpoints = queryCheckpoints;
+  convergence.journal = journal;
+  convergence.journalEnd = queryJournal;
+  convergence.encodings = encodings;
+  converging = true;
+}
+
+//when the current state matches the previous run at the given checkpoint, the rest of the previous Query phase
+//is reused: its remaining constants, encodings and checkpoints are appended, and execution ends here
+auto Bass::converged(uint index) -> bool {
+  auto& previous = convergence.checkpoints[index];
+  if(previous.journal != journal.size()) return false;
+  for(uint64_t n = convergence.journalStart; n < journal.size(); n++) {
+    if(!(journal[n] == convergence.journal[n])) return false;
+  }
+  if(!sameState(previous)) return false;
+
+  for(uint64_t n = previous.journal; n < convergence.journalEnd; n++) {
+    auto& change = convergence.journal[n];
+    if(auto constant = constants.find({change.name})) constant().value = change.value;
+    else constants.insert({change.name, change.value});
+    journal.append(change);
+  }
+
+  uint encodingsOffset = encodings.size() - previous.encodings;
+  for(uint n = previous.encodings; n < convergence.encodings.size(); n++) {
+    encodings.append(convergence.encodings[n]);
+  }
+
+  for(uint n = index; n < convergence.checkpoints.size(); n++) {
+    auto checkpoint = convergence.checkpoints[n];
+    auto ip = convergence.translate(checkpoint.ip);
+    auto reach = convergence.translate(checkpoint.reach);
+    bool valid = ip && reach;
+    checkpoint.frame.macros.foreach([&](Macro& macro) {
+      if(auto ip = convergence.translate(macro.ip)) macro.ip = ip();
+      else valid = false;
+    });
+    if(!valid) break;
+    checkpoint.ip = ip();
+    checkpoint.reach = reach();
+    checkpoint.encodings += encodingsOffset;
+    queryCheckpoints.append(move(checkpoint));
+  }
+
+  ip = program.size();
+  converging = false;
+  return true;
+}
+
+//compares the execution state against that of a checkpoint, apart from constants
+auto Bass::sameState(const Checkpoint& previous) -> bool {
+  if(previous.origin != origin || previous.base != base || previous.endian != endian) return false;
+  if(previous.lastLabelCounter != lastLabelCounter || previous.nextLabelCounter != nextLabelCounter) return false;
+  if(previous.macroInvocationCounter != macroInvocationCounter) return false;
+  if(previous.queue != queue || previous.scope != scope || previous.conditionals != conditionals) return false;
+  if(previous.loops.size() != loops.size()) return false;
+  for(uint n : range(loops.size())) {
+    auto& loop = previous.loops[n];
+    if(loop.name != loops[n].name || loop.value != loops[n].value || loop.step != loops[n].step || loop.count != loops[n].count) return false;
+  }
+  if(memory::compare(previous.stringTable, stringTable, sizeof(stringTable))) return false;
+  if(previous.tracking != tracker.enable) return false;
+  if(previous.architectureName != architectureName) return false;
+  if(!previous.architecture->aligned() || !architecture->aligned()) return false;
+  if(previous.directives.EmitBytes.size() != directives.EmitBytes.size()) return false;
+  for(uint n : range(directives.EmitBytes.size())) {
+    auto& directive = previous.directives.EmitBytes[n];
+    if(directive.token != directives.EmitBytes[n].token || directive.dataLength != directives.EmitBytes[n].dataLength) return false;
+  }
+  return frames.size() == 1 && sameFrame(previous.frame);
+}
+
+//compares the root frame against that of a checkpoint
+//while converging, its macros are at statement indices of the previous program
+auto Bass::sameFrame(const Frame& previous) -> bool {
+  auto& frame = frames.first();
+  if(previous.macros.size() != frame.macros.size()) return false;
+  if(previous.defines.size() != frame.defines.size()) return false;
+  if(previous.expressions.size() != frame.expressions.size()) return false;
+  if(previous.variables.size() != frame.variables.size()) return false;
+  if(previous.arrays.size() != frame.arrays.size()) return false;
+
+  bool same = true;
+  previous.macros.foreach([&](const Macro& macro) {
+    if(!same) return;
+    auto current = frame.macros.find(macro);
+    auto ip = converging ? convergence.translate(macro.ip) : maybe<uint>{macro.ip};
+    same = current && ip && current().ip == ip() && current().inlined == macro.inlined && current().parameters == macro.parameters;
+  });
+  previous.defines.foreach([&](const Define& define) {
+    if(!same) return;
+    auto current = frame.defines.find(define);
+    same = current && current().value == define.value && current().parameters == define.parameters;
+  });
+  previous.expressions.foreach([&](const Expression& expression) {
+    if(!same) return;
+    auto current = frame.expressions.find(expression);
+    same = current && current().value == expression.value && current().parameters == expression.parameters;
+  });
+  previous.variables.foreach([&](const Variable& variable) {
+    if(!same) return;
+    auto current = frame.variables.find(variable);
+    same = current && current().value == variable.value;
+  });
+  previous.arrays.foreach([&](const Array& array) {
+    if(!same) return;
+    auto current = frame.arrays.find(array);
+    same = current && current().values == array.values;
+  });
+  return same;
+}
+
+auto Bass::checkpoint() -> void {
+  executed = 0;
+  //overwrite detection is not journaled, so the Write phase is only resumed from before it was first enabled
+  if(writePhase() && (tracker.enable || tracker.pages)) return;
+
+  if(queryPhase()) queryCheckpoints.append(capture());
+  if(writePhase()) writeCheckpoints.append(capture());
+}
+
+auto Bass::capture() -> Checkpoint {
+  Checkpoint checkpoint;
+  checkpoint.ip = ip;
+  checkpoint.reach = reach;
+  checkpoint.frame = frames.first();
+  checkpoint.conditionals = conditionals;
+  checkpoint.loops = loops;
+  checkpoint.queue = queue;
+  checkpoint.scope = scope;
+  memory::copy(checkpoint.stringTable, stringTable, sizeof(stringTable));
+  checkpoint.tracking = tracker.enable;
+  checkpoint.endian = endian;
+  checkpoint.origin = origin;
+  checkpoint.base = base;
+  checkpoint.lastLabelCounter = lastLabelCounter;
+  checkpoint.nextLabelCounter = nextLabelCounter;
+  checkpoint.macroInvocationCounter = macroInvocationCounter;
+  checkpoint.architecture = architecture->clone();
+  checkpoint.architectureName = architectureName;
+  checkpoint.directives = directives;
+  checkpoint.checksums = checksums;
+  checkpoint.regions = regions;
+  checkpoint.journal = journal.size();
+  checkpoint.encodings = queryPhase() ? encodings.size() : encodingIndex;
+  checkpoint.diverged = writePhase() && encodingIndex >= encodings.size();
+  checkpoint.image = writePhase() ? targetFile.checkpoint() : 0;
+  checkpoint.imageSize = targetFile.size();
+  checkpoint.position = targetFile.offset();
+  return checkpoint;
+}
+
+auto Bass::resume(const Checkpoint& checkpoint) -> void {
+  frames.reset();
+  frames.append(checkpoint.frame);
+  conditionals = checkpoint.conditionals;
+  loops = checkpoint.loops;
+  queue = checkpoint.queue;
+  scope = checkpoint.scope;
+  memory::copy(stringTable, checkpoint.stringTable, sizeof(stringTable));
+  tracker.enable = checkpoint.tracking;
+  endian = checkpoint.endian;
+  origin = checkpoint.origin;
+  base = checkpoint.base;
+  lastLabelCounter = checkpoint.lastLabelCounter;
+  nextLabelCounter = checkpoint.nextLabelCounter;
+  macroInvocationCounter = checkpoint.macroInvocationCounter;
+  architecture = checkpoint.architecture->clone();
+  architectureName = checkpoint.architectureName;
+  directives = checkpoint.directives;
+  checksums = checkpoint.checksums;
+  regions = checkpoint.regions;
+  encoding = nullptr;
+  ip = checkpoint.ip;
+  reach = checkpoint.reach;
+  executed = 0;
+}
+
+//reverts constants to how they were when the journal had the given length
+auto Bass::undo(uint64_t position) -> void {
+  while(journal.size() > position) {
+    auto change = journal.takeRight();
+    if(!change.existed) constants.remove({change.name});
+    else if(auto constant = constants.find({change.name})) constant().value = change.previous;
+  }
+}
+
+//identifies the contents of a file without reading it
+auto Bass::stamp(const string& filename) -> string {
+  struct stat data;
+  if(stat(filename, &data) != 0) return "missing";
+  #if defined(PLATFORM_LINUX)
+  return {data.st_mtim.tv_sec, ".", data.st_mtim.tv_nsec, " ", data.st_size};
+  #else
+  return {data.st_mtime, " ", data.st_size};
+  #endif
+}
+
+//remembers the inputs that reassemble() cannot track changes within, once an assembly has succeeded
+//sources are compared statement by statement instead
+auto Bass::record() -> void {
+  inputStamps.reset();
+  for(auto& filename : inputFilenames) {
+    if(sourceFilenames.find(filename)) continue;
+    //as read, so that a file changed during the assembly is seen as changed by the next reassemble()
+    if(auto before = readStamps.find(filename)) inputStamps.insert(filename, before());
+    else inputStamps.insert(filename, stamp(filename));
+  }
+  inputStamps.insert(targetName, stamp(targetName));
+  resumable = true;
+}
@@ -1,35 +1,172 @@
+#include "image.cpp"
 #include "evaluate.cpp"
 #include "analyze.cpp"
 #include "execute.cpp"
 #include "assemble.cpp"
+#include "encode.cpp"
+#include "outputs.cpp"
 #include "utility.cpp"
+#include "cache.cpp"
+#include "checkpoint.cpp"
+#include "object.cpp"
+#include "symbols.cpp"
 
-auto Bass::target(const string& filename, bool create) -> bool {
-  if(targetFile) targetFile.close();
-  if(!filename) return true;
+auto Bass::target(const string& filename, bool create, const string& baseFilename) -> bool {
+  closeTarget();
+
+  //without a target, output is collected and written to stdout at the end (unless it is a terminal)
+  if(!filename) {
+    if(!isatty(fileno(stdout))) targetFile.open();
+    return true;
+  }
+
+  targetFilenames.insert(filename);
+  targetFilename = filename;
+  targetName = create && !baseFilename ? filename : string{};
+
+  //start from a copy of the base image, which is shared with the target where the file system allows
+  //only the pages that are then modified get written back by Image::close()
+  if(baseFilename) {
+    depend(baseFilename);
+    if(!file::copy(baseFilename, filename)) {
+      report("warning: unable to copy base image: ", baseFilename, "\n");
+      return false;
+    }
+    create = false;
+  }
 
   //cannot modify a file unless it exists
   if(!file::exists(filename)) create = true;
 
-  if(!targetFile.open(filename, create ? file::mode::write : file::mode::modify)) {
-    print(stderr, "warning: unable to open target file: ", filename, "\n");
+  //the prior contents of a modified file are not known to the build cache
+  if(!create && !baseFilename) cacheable = false;
+
+  if(!targetFile.open(filename, create)) {
+    report("warning: unable to open target file: ", filename, "\n");
     return false;
   }
 
-  tracker.addresses.reset();
+  tracker.reset();
   return true;
 }
 
+//the target is kept in memory, and available from image() once assembled
+auto Bass::target() -> void {
+  closeTarget();
+  targetFile.open(imageData);
+  targetName = {};
+  tracker.reset();
+}
+
+//assemble against a read-only base image, writing only the differences to a BPS or IPS patch
+auto Bass::patch(const string& baseFilename, const string& patchFilename) -> bool {
+  closeTarget();
+
+  depend(baseFilename);
+  if(!targetFile.patch(baseFilename, patchFilename)) {
+    report("warning: unable to open base file: ", baseFilename, "\n");
+    return false;
+  }
+  targetFilenames.insert(patchFilename);
+  targetFilename = patchFilename;
+  targetName = {};
+
+  tracker.reset();
+  return true;
+}
+
+auto Bass::cache(const string& pathname) -> void {
+  cacheDirectory = pathname;
+  if(cacheDirectory && !cacheDirectory.endsWith("/")) cacheDirectory.append("/");
+}
+
+auto Bass::fixups(bool enable) -> void {
+  reuseEncodings = enable;
+}
+
+auto Bass::relax(uint passes) -> void {
+  relaxPasses = passes;
+  relaxSizes = passes > 0;
+}
+
+//with checkpoints enabled, assemble() records enough state for reassemble() to later resume from
+//the last checkpoint before the first statement that changed, rather than from the start of the program
+auto Bass::checkpoints(bool enable) -> void {
+  checkpointing = enable;
+}
+
+//worker threads used to encode forward references before the Write phase (only when fixups are enabled), and output files
+auto Bass::threads(uint count) -> void {
+  threadCount = count;
+}
+
+//diagnostics are passed to handler rather than printed, so that concurrent assemblies (-batch) do not interleave
+auto Bass::diagnostics(const function<void (const string&)>& handler) -> void {
+  diagnosticHandler = handler;
+}
+
+//provider is asked for every source, include and inserted file before the file system is searched
+//it returns nothing for files it does not supply
+auto Bass::files(const function<maybe<vector<uint8_t>> (const string&)>& provider) -> void {
+  fileProvider = provider;
+}
+
+//sources lexed by any Bass given the same cache are reused for as long as they are unchanged
+//the cache grows with every distinct file lexed, and is released along with the last reference to it
+auto Bass::sources(const shared_pointer<SourceCache>& cache) -> void {
+  sourceCache = cache;
+}
+
 auto Bass::source(const string& filename) -> bool {
-  if(!file::exists(filename)) {
-    print(stderr, "warning: source file not found: ", filename, "\n");
+  rootFilenames.append(filename);
+  return include(filename);
+}
+
+//assembles data as if it were the contents of filename, which need not exist
+//includes and inserts are relative to the path of filename
+auto Bass::source(const string& filename, const string& data) -> bool {
+  memoryFiles.insert(filename, data);
+  return source(filename);
+}
+
+auto Bass::include(const string& filename) -> bool {
+  if(!inputExists(filename)) {
+    report("warning: source file not found: ", filename, "\n");
     return false;
   }
 
   uint fileNumber = sourceFilenames.size();
   sourceFilenames.append(filename);
+  depend(filename);
 
-  string data = file::read(filename);
+  for(auto& instruction : lex(filename)) {
+    string statement = instruction.statement;
+    if(statement.match("include \"?*\"")) {
+      statement.trimLeft("include ", 1L).strip();
+      include({Location::path(filename), text(statement)});
+    } else {
+      program.append(instruction);
+      program.last().fileNumber = fileNumber;
+    }
+  }
+
+  return true;
+}
+
+//splits a source file into statements
+//with a source cache, the result is kept for as long as the file is unchanged, so that repeated assemblies (-watch, -batch) skip this
+//the cache may be shared with other Bass instances, and so the result is returned as a copy
+auto Bass::lex(const string& filename) -> vector<Instruction> {
+  string data = readInput(filename);
+  if(sourceCache) {
+    lock_guard<mutex> lock(sourceCache->lock);
+    if(auto source = sourceCache->files.find(filename)) {
+      if(source().data == data) return source().instructions;
+    }
+  }
+
+  SourceFile source;
+  source.data = data;
   data.transform("\t\r", "  ");
 
   auto lines = data.split("\n");
@@ -46,21 +183,19 @@ auto Bass::source(const string& filename) -> bool {
       strip(statement);
       if(!statement) continue;
 
-      if(statement.match("include \"?*\"")) {
-        statement.trimLeft("include ", 1L).strip();
-        source({Location::path(filename), text(statement)});
-      } else {
-        Instruction instruction;
-        instruction.statement = statement;
-        instruction.fileNumber = fileNumber;
-        instruction.lineNumber = 1 + lineNumber;
-        instruction.blockNumber = 1 + blockNumber;
-        program.append(instruction);
-      }
+      Instruction instruction;
+      instruction.statement = statement;
+      instruction.lineNumber = 1 + lineNumber;
+      instruction.blockNumber = 1 + blockNumber;
+      source.instructions.append(instruction);
     }
   }
 
-  return true;
+  if(sourceCache) {
+    lock_guard<mutex> lock(sourceCache->lock);
+    sourceCache->files.insert(filename, source);
+  }
+  return source.instructions;
 }
 
 auto Bass::define(const string& name, const string& value) -> void {
@@ -70,31 +205,77 @@ auto Bass::define(const string& name, const string& value) -> void {
 auto Bass::constant(const string& name, const string& value) -> void {
   try {
     constants.insert({name, evaluate(value, Evaluation::Strict)});
+    predefinedConstants.append({name, evaluate(value, Evaluation::Strict)});
   } catch(...) {
   }
 }
 
 auto Bass::assemble(bool strict) -> bool {
   this->strict = strict;
+  diagnosticLog = {};
+  //checkpoints can only resume an assembly that recreates a single target from scratch
+  if(relaxPasses || !targetName || objectFilename || objectFilenames) checkpointing = false;
+  resumable = false;
 
   try {
+    //objects given to link() take the place of sources
+    if(objectFilenames) {
+      phase = Phase::Write;
+      linkObjects();
+      closeTarget();
+      return true;
+    }
+
     phase = Phase::Analyze;
     analyze();
 
-    phase = Phase::Query;
-    architecture = new Architecture{*this};
-    execute();
+    if(!deferAssembly()) {
+      phase = Phase::Query;
+      architecture = new Architecture{*this};
+      journal.reset();
+      queryCheckpoints.reset();
+      execute();
+      if(relaxPasses) relaxQuery();
+      queryJournal = journal.size();
+      if(reuseEncodings) encodeForward();
 
-    phase = Phase::Write;
-    architecture = new Architecture{*this};
-    execute();
+      phase = Phase::Write;
+      architecture = new Architecture{*this};
+      writeCheckpoints.reset();
+      targetFile.journal(checkpointing);
+      if(!writeOutputs()) execute();
+    }
+    if(objectFilename) writeObject();
+    closeTarget();
+    if(symbolFilename) writeSymbols();
   } catch(...) {
     return false;
   }
 
+  if(checkpointing) record();
   return true;
 }
 
+//writes a make rule listing every file the targets were assembled from
+//each input also gets an empty rule, so that make does not fail once it is deleted or renamed
+auto Bass::dependencies(const string& filename) -> bool {
+  auto escape = [](string name) -> string {
+    return name.replace("$", "$$").replace(" ", "\\ ").replace("#", "\\#");
+  };
+
+  string rule;
+  if(!targetFilenames) rule.append(escape(filename));
+  for(auto& name : targetFilenames) rule.append(rule ? " " : "", escape(name));
+  rule.append(":");
+  //files that do not exist are left out, as make would then always consider the targets out of date
+  string_vector inputs;
+  for(auto& name : inputFilenames) if(file::exists(name)) inputs.append(name);
+  for(auto& name : inputs) rule.append(" \\\n  ", escape(name));
+  rule.append("\n");
+  for(auto& name : inputs) rule.append("\n", escape(name), ":\n");
+  return file::write(filename, rule);
+}
+
 //internal
 
 auto Bass::pc() const -> uint {
@@ -103,50 +284,257 @@ auto Bass::pc() const -> uint {
 
 auto Bass::seek(uint offset) -> void {
   if(!targetFile) return;
-  if(writePhase()) targetFile.seek(offset);
+  if(emitting()) targetFile.seek(offset);
 }
 
 auto Bass::track(uint length) -> void {
   if(!tracker.enable) return;
   uint64_t address = targetFile.offset();
-  for(auto n : range(length)) {
-    if(tracker.addresses.find(address + n)) {
-      error("overwrite detected at address 0x", hex(address + n), " [0x", hex(base + address + n), "]");
-    }
-    tracker.addresses.insert(address + n);
+  if(auto overlap = tracker.insert(address, length)) {
+    error("overwrite detected at address 0x", hex(overlap()), " [0x", hex(base + overlap()), "]");
   }
 }
 
+//marks [address, address + length) as written
+//returns the first address in the range that had already been written, if any
+auto Bass::Tracker::insert(uint64_t address, uint64_t length) -> maybe<uint64_t> {
+  maybe<uint64_t> overlap;
+  while(length) {
+    uint64_t page = address >> PageBits;
+    if(page >= pages.size()) pages.resize(page + 1);
+    if(!pages[page]) pages[page].resize(PageSize / 64);
+
+    uint64_t& word = pages[page][(address & PageSize - 1) >> 6];
+    uint shift = address & 63;
+    uint64_t count = min(length, 64 - shift);
+    uint64_t mask = (count == 64 ? ~0ull : (1ull << count) - 1) << shift;
+    if(!overlap && (word & mask)) overlap = address + bit::first(word & mask) - shift;
+    word |= mask;
+
+    address += count;
+    length -= count;
+  }
+  return overlap;
+}
+
 auto Bass::write(uint64_t data, uint length) -> void {
-  if(writePhase()) {
+  if(encoding) {
+    for(uint n : range(length)) {
+      uint shift = endian == Endian::LSB ? n : length - 1 - n;
+      encoding->data.append(data >> shift * 8);
+    }
+  }
+  if(emitting()) {
     if(targetFile) {
       track(length);
       if(endian == Endian::LSB) targetFile.writel(data, length);
       if(endian == Endian::MSB) targetFile.writem(data, length);
-    } else if(!isatty(fileno(stdout))) {
-      if(endian == Endian::LSB) for(uint n : range(length)) fputc(data >> n * 8, stdout);
-      if(endian == Endian::MSB) for(uint n : reverse(range(length))) fputc(data >> n * 8, stdout);
+    }
+    if(objectFilename) {
+      vector<uint8_t> bytes;
+      for(uint n : range(length)) bytes.append(data >> (endian == Endian::LSB ? n : length - 1 - n) * 8);
+      sectionWrite(bytes);
     }
   }
   origin += length;
 }
 
+//writes a block of elements, each stored least significant byte first
+//the tracker and origin are updated once for the entire block
+auto Bass::writeBlock(array_view<uint8_t> data, uint length) -> void {
+  if(emitting() || encoding) {
+    vector<uint8_t> swapped;
+    if(endian == Endian::MSB && length > 1) {
+      swapped.resize(data.size());
+      for(uint64_t offset = 0; offset + length <= data.size(); offset += length) {
+        for(uint n : range(length)) swapped[offset + n] = data[offset + length - 1 - n];
+      }
+      data = swapped;
+    }
+    //data directives are recorded along with instructions while deferring (see assembleData())
+    if(encoding) {
+      for(auto byte : data) encoding->data.append(byte);
+    }
+    if(emitting() && targetFile) {
+      track(data.size());
+      targetFile.write(data);
+    }
+    if(emitting() && objectFilename) sectionWrite(data);
+  }
+  origin += data.size();
+}
+
+auto Bass::fillBlock(uint8_t data, uint64_t length) -> void {
+  if(emitting() && targetFile) {
+    track(length);
+    targetFile.fill(data, length);
+  }
+  if(emitting() && objectFilename) sectionFill(data, length);
+  origin += length;
+}
+
+auto Bass::closeTarget() -> void {
+  if(!targetFile) return;
+  if(targetFile.streaming() && targetFile.size()) cacheable = false;
+  updateChecksums();
+  captureRegions();
+  if(auto message = targetFile.close()) report(message);
+  targetFilename = {};
+}
+
+//checksums are computed over the final image, right before the target is closed
+auto Bass::updateChecksums() -> void {
+  auto store = [&](uint64_t address, uint64_t data, uint length, Endian endian) {
+    targetFile.seek(address);
+    if(endian == Endian::LSB) targetFile.writel(data, length);
+    if(endian == Endian::MSB) targetFile.writem(data, length);
+  };
+
+  vector<uint8_t> buffer;
+  buffer.resize(65536);
+  auto scan = [&](uint64_t offset, uint64_t length, auto&& callback) {
+    targetFile.seek(offset);
+    while(length) {
+      uint64_t size = min(length, buffer.size());
+      targetFile.read({buffer.data(), size});
+      callback(buffer.data(), size);
+      length -= size;
+    }
+  };
+
+  for(auto& checksum : checksums) {
+    if(checksum.type == Checksum::Type::SNES) {
+      //complement and checksum fields sum to $1fe regardless of their value
+      store(checksum.address, 0x0000'ffff, 4, Endian::LSB);
+      //sizes that are not a power of two are mirrored up to the next power of two, as emulators and header tools do:
+      //the part past the largest power of two is itself split this way, and repeated until it is as large as that power
+      function<uint16_t (uint64_t, uint64_t&, uint64_t)> mirrorSum = [&](uint64_t offset, uint64_t& length, uint64_t mask) -> uint16_t {
+        while(mask && !(length & mask)) mask >>= 1;
+        uint16_t sum = 0;
+        scan(offset, mask, [&](const uint8_t* data, uint64_t length) {
+          for(uint64_t n : range(length)) sum += data[n];
+        });
+        uint64_t rest = length - mask;
+        if(rest) {
+          uint16_t mirror = mirrorSum(offset + mask, rest, mask >> 1);
+          while(rest < mask) rest += rest, mirror += mirror;
+          sum += mirror;
+          length = mask + mask;
+        }
+        return sum;
+      };
+      uint64_t size = targetFile.size();
+      uint16_t sum = mirrorSum(0, size, 1ull << 63);
+      store(checksum.address, (uint64_t)sum << 16 | sum ^ 0xffff, 4, Endian::LSB);
+    }
+
+    if(checksum.type == Checksum::Type::N64) {
+      uint32_t seed = 0xf8ca4ddc;
+      if(checksum.cic == 6103) seed = 0xa3886759;
+      if(checksum.cic == 6105) seed = 0xdf26f436;
+      if(checksum.cic == 6106) seed = 0x1fea617a;
+      vector<uint8_t> boot;
+      boot.resize(0x1000);
+      targetFile.seek(0);
+      targetFile.read(boot);
+
+      uint32_t t1 = seed, t2 = seed, t3 = seed, t4 = seed, t5 = seed, t6 = seed;
+      uint64_t offset = 0;
+      scan(0x1000, 0x100000, [&](const uint8_t* data, uint64_t length) {
+        for(uint64_t n = 0; n < length; n += 4, offset += 4) {
+          uint32_t d = data[n] << 24 | data[n + 1] << 16 | data[n + 2] << 8 | data[n + 3];
+          uint32_t r = d << (d & 31) | d >> (32 - (d & 31) & 31);
+          if(t6 + d < t6) t4++;
+          t6 += d;
+          t3 ^= d;
+          t5 += r;
+          if(t2 > d) t2 ^= r;
+          else t2 ^= t6 ^ d;
+          if(checksum.cic == 6105) {
+            uint i = 0x0750 + (offset & 0xff);
+            t1 += (boot[i] << 24 | boot[i + 1] << 16 | boot[i + 2] << 8 | boot[i + 3]) ^ d;
+          } else {
+            t1 += t5 ^ d;
+          }
+        }
+      });
+
+      uint32_t crc1 = t6 ^ t4 ^ t3, crc2 = t5 ^ t2 ^ t1;
+      if(checksum.cic == 6103) crc1 = (t6 ^ t4) + t3, crc2 = (t5 ^ t2) + t1;
+      if(checksum.cic == 6106) crc1 = t6 * t4 + t3, crc2 = t5 * t2 + t1;
+      store(0x10, crc1, 4, Endian::MSB);
+      store(0x14, crc2, 4, Endian::MSB);
+    }
+
+    if(checksum.type == Checksum::Type::CRC32) {
+      Hash::CRC32 hash;
+      scan(checksum.offset, checksum.length, [&](const uint8_t* data, uint64_t length) {
+        hash.input(data, length);
+      });
+      store(checksum.address, hash.value(), 4, checksum.endian);
+    }
+  }
+
+  checksums.reset();
+}
+
+//results are kept for the Write phase, and in the cache directory (if any) for later runs
+//the key covers the codec and its parameters as well as the data, so a stale entry is never used
+auto Bass::compress(const string& codec, array_view<uint8_t> data) -> vector<uint8_t> {
+  Hash::SHA256 hash;
+  hash.input(codec);
+  hash.input(data);
+  string key = {hash.digest(), ".", codec};
+  if(auto output = compressed.find(key)) return output();
+
+  string filename = cacheDirectory ? string{cacheDirectory, key} : string{};
+  vector<uint8_t> output;
+  if(filename && file::exists(filename)) {
+    output = file::read(filename);
+  } else {
+    if(codec == "lzsa") output = Encode::LZSA(data);
+    else if(codec == "huffman") output = Encode::Huffman(data);
+    else if(codec == "rle") output = Encode::RLE<1>(data);
+    else if(codec == "rle16") output = Encode::RLE<2>(data);
+    else error("unrecognized codec: ", codec);
+    //write under a temporary name first, so concurrent builds never read a partial entry
+    if(filename && directory::create(cacheDirectory)) {
+      string temporary = {filename, ".", getpid(), ".", hex((uintptr)this)};
+      if(file::write(temporary, output)) file::move(temporary, filename);
+    }
+  }
+  compressed.insert(key, output);
+  return output;
+}
+
+template<typename... P> auto Bass::report(P&&... p) -> void {
+  if(quiet) return;
+  string message{forward<P>(p)...};
+  if(deferring) {
+    deferredLog.append(message);
+    return;
+  }
+  if(cacheDirectory) diagnosticLog.append(message);
+  if(!diagnosticHandler) return print(stderr, message);
+  diagnosticHandler(message);
+}
+
 auto Bass::printInstruction() -> void {
   if(activeInstruction) {
     auto& i = *activeInstruction;
-    print(stderr, sourceFilenames[i.fileNumber], ":", i.lineNumber, ":", i.blockNumber, ": ", i.statement, "\n");
+    report(sourceFilenames[i.fileNumber], ":", i.lineNumber, ":", i.blockNumber, ": ", i.statement, "\n");
   }
 }
 
 template<typename... P> auto Bass::notice(P&&... p) -> void {
   string s{forward<P>(p)...};
-  print(stderr, terminal::color::gray("notice: "), s, "\n");
+  report(terminal::color::gray("notice: "), s, "\n");
   printInstruction();
 }
 
 template<typename... P> auto Bass::warning(P&&... p) -> void {
   string s{forward<P>(p)...};
-  print(stderr, terminal::color::yellow("warning: "), s, "\n");
+  report(terminal::color::yellow("warning: "), s, "\n");
   if(!strict) {
     printInstruction();
     return;
@@ -159,7 +547,7 @@ template<typename... P> auto Bass::warning(P&&... p) -> void {
 
 template<typename... P> auto Bass::error(P&&... p) -> void {
   string s{forward<P>(p)...};
-  print(stderr, terminal::color::red("error: "), s, "\n");
+  report(terminal::color::red("error: "), s, "\n");
   printInstructionStack();
 
   struct BassError {};
@@ -172,7 +560,7 @@ auto Bass::printInstructionStack() -> void {
   for(const auto& frame : reverse(frames)) {
     if(frame.ip > 0 && frame.ip <= program.size()) {
       auto& i = program[frame.ip - 1];
-      print(stderr, "   ", sourceFilenames[i.fileNumber], ":", i.lineNumber, ":", i.blockNumber, ": ", i.statement, "\n");
+      report("   ", sourceFilenames[i.fileNumber], ":", i.lineNumber, ":", i.blockNumber, ": ", i.statement, "\n");
     }
   }
 }
\ No newline at end of file
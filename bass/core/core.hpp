@@ -1,11 +1,36 @@
 struct Architecture;
 
 struct Bass {
-  auto target(const string& filename, bool create) -> bool;
+  auto target(const string& filename, bool create, const string& baseFilename = {}) -> bool;
+  auto target() -> void;
+  auto image() const -> const vector<uint8_t>& { return imageData; }
+  auto patch(const string& baseFilename, const string& patchFilename) -> bool;
+  auto cache(const string& pathname) -> void;
+  auto fixups(bool enable) -> void;
+  auto relax(uint passes = 16) -> void;
+  auto checkpoints(bool enable) -> void;
+  auto threads(uint count) -> void;
+  auto object(const string& filename) -> void;
+  auto link(const string& filename) -> bool;
+  auto place(const string& section, uint64_t offset, int64_t base) -> void;
+  auto symbols(const string& filename) -> void;
+  auto diagnostics(const function<void (const string&)>& handler) -> void;
+  auto files(const function<maybe<vector<uint8_t>> (const string&)>& provider) -> void;
+  struct SourceCache;
+  auto sources(const shared_pointer<SourceCache>& cache) -> void;
   auto source(const string& filename) -> bool;
+  auto source(const string& filename, const string& data) -> bool;
+  auto inputs() const -> const set<string>& { return inputFilenames; }
+  //stamp() of each input from just before it was first read, so that changes made during assembly can be detected
+  auto stamps() const -> const map<string, string>& { return readStamps; }
+  static auto stamp(const string& filename) -> string;
   auto define(const string& name, const string& value) -> void;
   auto constant(const string& name, const string& value) -> void;
   auto assemble(bool strict = false) -> bool;
+  auto reassemble() -> maybe<bool>;
+  auto dependencies(const string& filename) -> bool;
+  auto restore(const string& key) -> bool;
+  auto store(const string& key) -> bool;
 
   enum class Phase : uint { Analyze, Query, Write };
   enum class Endian : uint { LSB, MSB };
@@ -97,16 +122,70 @@ struct Bass {
     hashset<Array> arrays;
   };
 
+  struct SourceFile {
+    string data;
+    vector<Instruction> instructions;  //fileNumber is assigned once appended to the program
+  };
+
+  //lexed sources, owned by the caller and shared by the Bass instances it is given to
+  struct SourceCache {
+    map<string, SourceFile> files;
+    mutex lock;
+  };
+
   struct Block {
     uint ip;
     string type;
   };
 
+  struct Loop {
+    string name;     //induction variable (empty for repeat)
+    int64_t value;
+    int64_t step;
+    uint64_t count;  //iterations remaining, including the current one
+  };
+
   struct Tracker {
+    //one bit per written byte, allocated lazily in 32KB pages
+    enum : uint { PageBits = 15, PageSize = 1 << PageBits };
+
+    auto insert(uint64_t address, uint64_t length) -> maybe<uint64_t>;
+    auto reset() -> void { pages.reset(); }
+
     bool enable = false;
-    set<int64_t> addresses;
+    vector<vector<uint64_t>> pages;
+  };
+
+  struct Checksum {
+    enum class Type : uint { SNES, N64, CRC32 } type;
+    uint64_t address;  //where the result is stored
+    uint64_t offset;   //range covered by the checksum (CRC32 only)
+    uint64_t length;
+    uint cic;          //boot chip variant (N64 only)
+    Endian endian;
+  };
+
+  //an instruction as assembled during the Query phase, for reuse by the Write phase
+  struct Encoding {
+    string statement;
+    uint origin;
+    int base;
+    Endian endian;
+    string architecture;
+    uint lastLabelCounter;
+    uint nextLabelCounter;
+    string scope;             //joined by '.'
+    vector<Variable> inputs;  //every variable and constant the encoding was computed from
+    vector<uint8_t> data;
+    bool reusable = true;     //false once a phase-dependent value was evaluated
+    bool forward = false;     //a name was not defined yet: encoded again by encodeForward() once all constants are known
+    uint dataLength = 0;      //data directives (while deferring): bytes per value, and the statement is their operands
+    uint length = 0;          //while deferring: bytes the Query phase wrote, which encoding again must not change
   };
 
+  //thrown by undefer(), to assemble in two phases after all
+  struct Undeferred {};
+
   struct Directives {
   private:
     struct _EmitBytesOp {
@@ -126,31 +205,180 @@ struct Bass {
     }
   };
 
+  //a range of the target that is written to the symbol file along with the constants
+  struct Region {
+    uint64_t offset;
+    uint64_t length;
+    vector<uint8_t> data;  //read once the target is complete
+    bool captured = false;
+  };
+
+  //a value that is either absolute, or relative to a section or extern whose address is only known once linked
+  struct Reference {
+    enum : int { Absolute = -1 };  //sections are numbered upward from 0, externs downward from -2
+
+    int64_t value;
+    int group = Absolute;
+    //addresses may also be shifted right and masked (e.g. label >> 16), to be relocated as (address + addend >> shift) & mask
+    uint shift = 0;
+    int64_t mask = -1;
+    int64_t addend = 0;
+
+    auto linear() const -> bool { return shift == 0 && mask == -1; }
+  };
+
+  //object mode output: a run of bytes that the linker places as a whole
+  struct Section {
+    string name;
+    uint align = 1;
+    uint origin = 0;             //saved while another section is active
+    int base = 0;
+    vector<uint8_t> data;
+  };
+
+  //an operand that the linker still has to resolve
+  //instructions are encoded again by the linker from the table entry they were matched against
+  struct Relocation {
+    uint section;
+    uint offset;
+    int pc;                      //section-relative pc() of the instruction
+    Endian endian;
+    uint length;                 //data directives only: bytes written
+    string opcode;               //instructions only: "pattern ; format" table entry
+    vector<Reference> operands;
+  };
+
+  //a section of an object file being linked, and where it was placed
+  struct Placement {
+    string name;
+    uint align = 1;
+    vector<uint8_t> data;
+    uint64_t offset = 0;         //in the target file
+    int64_t base = 0;            //offset to memory address displacement
+    bool fixed = false;          //located by place(), rather than after the previous section
+  };
+
+  //an input file, either held in memory (see source() and files()) or mapped from disk
+  struct InputFile {
+    explicit operator bool() const { return found; }
+    auto data() const -> const uint8_t* { return mapped ? mapped.data() : buffer.data(); }
+    auto size() const -> uint64_t { return mapped ? mapped.size() : buffer.size(); }
+
+    bool found = false;
+    vector<uint8_t> buffer;
+    file_map mapped;
+  };
+
+  //assembler state between two top-level statements, from which reassemble() can resume execution
+  struct Checkpoint {
+    enum : uint { Interval = 4096 };  //statements executed between checkpoints
+
+    uint ip;
+    uint reach;                  //one past the furthest statement executed so far
+    Frame frame;
+    vector<bool> conditionals;
+    vector<Loop> loops;
+    string_vector queue;
+    string_vector scope;
+    int64_t stringTable[256];
+    bool tracking;               //overwrite detection enabled
+    Endian endian;
+    uint origin;
+    int base;
+    uint lastLabelCounter;
+    uint nextLabelCounter;
+    uint macroInvocationCounter;
+    shared_pointer<Architecture> architecture;  //a copy, as instrument statements modify the table
+    string architectureName;
+    Directives directives;
+    vector<Checksum> checksums;
+    vector<Region> regions;
+    uint64_t journal;            //length of the constants journal
+    uint encodings;              //Query: encodings recorded; Write: encodingIndex
+    bool diverged;               //Write: encodings are no longer compared
+    uint64_t image;              //Write: position in the target image journal
+    uint64_t imageSize;
+    uint64_t position;
+  };
+
+  //a target opened by a top-level output statement of the Query phase
+  //the Write phase from there on can run on a thread of its own (see writeOutputs())
+  struct Output {
+    string filename;
+    Checkpoint state;            //right before the output statement
+    uint64_t statements;         //executed by the Query phase before it
+  };
+
+  //a constant being defined or redefined, so that it can be undone
+  struct Change {
+    auto operator==(const Change& source) const -> bool {
+      return name == source.name && existed == source.existed && previous == source.previous && value == source.value;
+    }
+
+    string name;
+    bool existed;
+    int64_t previous;
+    int64_t value;
+  };
+
+  //the previous Query phase, which a resumed Query phase switches back to once it reaches the same state
+  struct Convergence {
+    auto translate(uint ip) const -> maybe<uint>;  //statement index in the previous program to one in the current program
+
+    uint prefix;                 //statements before the first change
+    uint suffix;                 //statements after the last change
+    uint previousSize;
+    uint size;
+    vector<int> candidates;      //index of the previous checkpoint at each statement (or -1)
+    vector<Checkpoint> checkpoints;
+    vector<Change> journal;
+    uint64_t journalEnd;         //end of the Query phase entries
+    uint64_t journalStart;       //position the Query phase was resumed from
+    vector<Encoding> encodings;
+  };
+
+  auto symbols() const -> vector<Constant>;
+
 protected:
   auto analyzePhase() const -> bool { return phase == Phase::Analyze; }
   auto queryPhase() const -> bool { return phase == Phase::Query; }
   auto writePhase() const -> bool { return phase == Phase::Write; }
+  //output is written by the Write phase, and while deferring by the Query phase as well
+  auto emitting() const -> bool { return phase == Phase::Write || deferring && phase == Phase::Query; }
 
   //core.cpp
+  auto include(const string& filename) -> bool;
+  auto lex(const string& filename) -> vector<Instruction>;
   auto pc() const -> uint;
   auto seek(uint offset) -> void;
   auto track(uint length) -> void;
   auto write(uint64_t data, uint length = 1) -> void;
+  auto writeBlock(array_view<uint8_t> data, uint length = 1) -> void;
+  auto fillBlock(uint8_t data, uint64_t length) -> void;
+  auto closeTarget() -> void;
+  auto updateChecksums() -> void;
+  auto compress(const string& codec, array_view<uint8_t> data) -> vector<uint8_t>;
 
   auto printInstruction() -> void;
   auto printInstructionStack() -> void;
+  template<typename... P> auto report(P&&... p) -> void;
   template<typename... P> auto notice(P&&... p) -> void;
   template<typename... P> auto warning(P&&... p) -> void;
   template<typename... P> auto error(P&&... p) -> void;
 
   //evaluate.cpp
+  auto relativeLabel(const string& expression) const -> maybe<string>;
   auto evaluate(const string& expression, Evaluation mode = Evaluation::Default) -> int64_t;
   auto evaluate(Eval::Node* node, Evaluation mode) -> int64_t;
+  auto evaluateQuietly(const string& expression) -> maybe<int64_t>;
+  auto parse(const string& expression) -> Eval::Node*;
+  auto assigns(Eval::Node* node) const -> bool;
   auto quantifyParameters(Eval::Node* node) -> int64_t;
   auto evaluateParameters(Eval::Node* node, Evaluation mode) -> vector<int64_t>;
   auto evaluateExpression(Eval::Node* node, Evaluation mode) -> int64_t;
   auto evaluateString(Eval::Node* node) -> string;
   auto evaluateLiteral(Eval::Node* node, Evaluation mode) -> int64_t;
+  auto decodeLiteral(const string& s) -> maybe<int64_t>;
   auto evaluateSubscript(Eval::Node* node, Evaluation mode) -> int64_t;
   auto evaluateAssign(Eval::Node* node, Evaluation mode) -> int64_t;
 
@@ -160,13 +388,29 @@ protected:
 
   //execute.cpp
   auto execute() -> bool;
+  auto run() -> void;
+  auto relaxQuery() -> void;
   auto executeInstruction(Instruction& instruction) -> bool;
 
   //assemble.cpp
   auto initialize() -> void;
   auto assemble(const string& statement) -> bool;
+  auto assembleInstruction(const string& statement) -> bool;
+  auto assembleData(const string& operands, uint dataLength) -> void;
   auto assembleString(const string& parameters) -> string;
 
+  //encode.cpp
+  auto encodeForward() -> void;
+  auto encodeFixups(const vector<uint>& pending, uint workers) -> void;
+  auto deferAssembly() -> bool;
+  auto undefer() -> void;
+  auto recordFixup(Encoding& e) -> void;
+  auto writeFixups() -> void;
+
+  //outputs.cpp
+  auto recordOutput(const string& filename, bool create) -> void;
+  auto writeOutputs() -> bool;
+
   //utility.cpp
   auto setMacro(const string& name, const string_vector& parameters, uint ip, bool inlined, Frame::Level level) -> void;
   auto findMacro(const string& name) -> maybe<Macro&>;
@@ -180,7 +424,7 @@ protected:
   auto setVariable(const string& name, int64_t value, Frame::Level level) -> void;
   auto findVariable(const string& name) -> maybe<Variable&>;
 
-  auto setConstant(const string& name, int64_t value) -> void;
+  auto setConstant(const string& name, int64_t value, int group = Reference::Absolute) -> void;
   auto findConstant(const string& name) -> maybe<Constant&>;
 
   auto setArray(const string& name, const vector<int64_t>& values, Frame::Level level) -> void;
@@ -189,14 +433,47 @@ protected:
   auto evaluateDefines(string& statement) -> void;
 
   auto readArchitecture(const string& s) -> string;
+  auto createArchitecture(const string& name) -> void;
 
   auto filepath() -> string;
+  auto inputExists(const string& filename) -> bool;
+  auto openInput(const string& filename) -> InputFile;
+  auto readInput(const string& filename) -> string;
+  auto depend(const string& filename) -> void;
+  auto digest(const string& filename) -> string;
   auto split(const string& s) -> string_vector;
   auto strip(string& s) -> void;
   auto validate(const string& s) -> bool;
   auto text(string s) -> string;
   auto character(const string& s) -> int64_t;
 
+  //object.cpp
+  auto pcGroup() const -> int;
+  auto reference(const string& expression) -> Reference;
+  auto symbolValue(const Constant& constant) -> int64_t;
+  auto groupValue(int64_t value, int group) -> int64_t;
+  auto selectSection(const string& name, uint align) -> void;
+  auto sectionWrite(array_view<uint8_t> data) -> void;
+  auto sectionFill(uint8_t data, uint64_t length) -> void;
+  auto writeObject() -> void;
+  auto linkObjects() -> void;
+
+  //symbols.cpp
+  auto captureRegions() -> void;
+  auto writeSymbols() -> void;
+  auto importSymbols(const string& filename) -> void;
+
+  //checkpoint.cpp
+  auto checkpoint() -> void;
+  auto capture() -> Checkpoint;
+  auto resume(const Checkpoint& checkpoint) -> void;
+  auto undo(uint64_t position) -> void;
+  auto converge(const vector<Instruction>& previous, uint prefix, uint suffix) -> void;
+  auto converged(uint index) -> bool;
+  auto sameState(const Checkpoint& previous) -> bool;
+  auto sameFrame(const Frame& previous) -> bool;
+  auto record() -> void;
+
   //internal state
   Instruction* activeInstruction = nullptr;  //used by notice, warning, error
   vector<Instruction> program;    //parsed source code statements
@@ -205,12 +482,16 @@ protected:
   hashset<Constant> constants;    //constants support forward-declaration
   vector<Frame> frames;           //macros, defines and variables do not
   vector<bool> conditionals;      //track conditional matching
+  vector<Loop> loops;             //track for, repeat iteration
   string_vector queue;            //track enqueue, dequeue directives
   string_vector scope;            //track scope recursion
   int64_t stringTable[256];       //overrides for d[bwldq] text strings
   Phase phase;                    //phase of assembly
   Endian endian = Endian::LSB;    //used for multi-byte writes (d[bwldq], etc)
   Tracker tracker;                //used to track writes to detect overwrites
+  vector<Checksum> checksums;     //computed once all writes to the target are complete
+  map<string, vector<uint8_t>> compressed;  //insert.codec results, keyed by content hash
+  string cacheDirectory;          //insert.codec results persisted across runs
   uint macroInvocationCounter;    //used for {#} support
   uint ip = 0;                    //instruction pointer into program
   uint origin = 0;                //file offset
@@ -219,10 +500,72 @@ protected:
   uint nextLabelCounter = 1;      //+ instance counter
   bool charactersUseMap = false;  //0 = '*' parses as ASCII; 1 = '*' uses stringTable[]
   bool strict = false;            //upgrade warnings to errors when true
+  function<void (const string&)> diagnosticHandler;  //receives diagnostics in place of stderr
+  string diagnosticLog;           //everything reported, replayed when the build is restored from the cache
   Directives directives;          //active directives
 
-  file_buffer targetFile;
+  Image targetFile;                //written pages are flushed once the target is closed
+  string targetFilename;          //of the open target, when it is a file
+  vector<uint8_t> imageData;      //in-memory target, filled in once it is closed
+  map<string, string> memoryFiles;  //sources given to source() along with their contents
+  function<maybe<vector<uint8_t>> (const string&)> fileProvider;  //consulted before the file system
   string_vector sourceFilenames;
+  shared_pointer<SourceCache> sourceCache;  //lexed sources kept between assemblies, when the caller supplies one
+  set<string> targetFilenames;    //every file written, for dependencies()
+  set<string> inputFilenames;     //every file read or probed, for dependencies()
+  map<string, string> readStamps; //stamp() of each of inputFilenames before it was read, for stamps()
+  bool cacheable = true;          //outputs depend only on inputFilenames
+  vector<Encoding> encodings;     //instructions from the Query phase, when fixups are enabled (while deferring, only fixups)
+  Encoding* encoding = nullptr;   //instruction being recorded
+  uint encodingIndex = 0;         //next instruction to compare against in the Write phase
+  string architectureName;        //architecture and instrument statements in effect
+  bool reuseEncodings = false;    //Write phase only assembles instructions whose encoding may have changed
+  uint threadCount = 1;           //for encodeForward() (0 = one per processor)
+  bool deferring = false;         //the Query phase writes the target, and the Write phase only its fixups (see deferAssembly())
+  string_vector deferredLog;      //while deferring: diagnostics, reported once the Write phase has succeeded
+  uint relaxPasses = 0;           //maximum number of Query phase passes (0 = one pass, without size relaxation)
+  bool relaxSizes = false;        //operands without a size hint are matched by the size of their value
+  bool quiet = false;             //report() discards diagnostics, while evaluating speculatively
+  uint queryPass = 0;             //Query phase pass, counting from zero
+  hashset<Constant> passConstants;        //constants defined during the current Query pass
+  bool constantsChanged = false;          //a constant was defined or changed value during the current Query pass
+  uint64_t constantsDigest = 0;           //identifies the constant values of the current Query pass
+  vector<Constant> predefinedConstants;   //specified on the terminal
+  bool checkpointing = false;             //record checkpoints and constant changes for reassemble()
+  bool resumable = false;                 //the last assembly can be continued by reassemble()
+  vector<Checkpoint> queryCheckpoints;
+  vector<Checkpoint> writeCheckpoints;
+  vector<Change> journal;                 //every constant change, in order
+  uint64_t queryJournal = 0;              //journal entries made by the Query phase
+  uint executed = 0;                      //statements executed since the last checkpoint
+  uint reach = 0;                         //one past the furthest statement executed
+  Convergence convergence;
+  bool converging = false;                //a resumed Query phase is looking for the state of the previous one
+  string_vector rootFilenames;            //sources given to source(), without their includes
+  string targetName;                      //created by target(), when reassemble() can update it in place
+  map<string, string> inputStamps;        //every input other than sources, as of the last assembly
+  string objectFilename;                  //object mode: sections, symbols and relocations are written here
+  vector<Section> sections;
+  uint sectionIndex = 0;                  //active section
+  hashset<Variable> relocatables;         //labels and externs, with their Reference group
+  string_vector externs;
+  set<string> exports;
+  vector<Relocation> relocations;
+  vector<int> referencedGroups;           //groups read while evaluating the current reference()
+  int perturbedGroup = Reference::Absolute;
+  int64_t perturbation = 0;               //added to every value of perturbedGroup
+  string_vector objectFilenames;          //to be linked by assemble()
+  map<string, Placement> placements;      //linked sections, some given a fixed location by place()
+  string symbolFilename;                  //constants and regions are written here once assembled
+  vector<Region> regions;
+  hashset<Constant> importedConstants;    //found only when not defined by the program itself
+  uint64_t statements = 0;                //executed by the current phase
+  vector<Output> outputs;                 //Query phase: in order of execution
+  bool independentOutputs = false;        //Query phase: every output can be written on a thread of its own
+  vector<bool> loopBodies;                //statements within a while loop
+  bool segmenting = false;                //Write phase: stop at an output statement once segmentOutputs have been opened
+  uint segmentOutputs = 0;
+  bool segmentEnded = false;
 
   shared_pointer<Architecture> architecture;
   friend class Architecture;
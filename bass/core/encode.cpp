@@ -0,0 +1,167 @@
+//with fixups enabled, the Query phase records the encoding of every instruction along with the state it was assembled in
+//instructions that evaluated a forward reference are encoded again here, now that every constant is known, on worker threads
+//each worker assembles from the recorded state: origin, base, endian, architecture, scope, label counters and variables
+//the Write phase then verifies that state before writing the result, as it does for every other encoding
+//while deferring, these are all the fixups, each of which writeFixups() then copies over its own range of the target
+//without fixups enabled nothing is recorded, so instructions are only ever encoded in order, by a single thread
+auto Bass::encodeForward() -> void {
+  enum : uint { Minimum = 256 };  //instructions per worker to make up for starting it
+
+  vector<uint> pending;
+  for(uint n : range(encodings.size())) {
+    if(encodings[n].reusable && encodings[n].forward) pending.append(n);
+  }
+  uint workers = threadCount ? threadCount : std::thread::hardware_concurrency();
+  workers = min(workers, pending.size() / Minimum);
+  if(workers < 2) return;  //left to the Write phase
+  encodeFixups(pending, workers);
+}
+
+//encodes the given encodings again from their recorded state, leaving forward set on those that could not be
+auto Bass::encodeFixups(const vector<uint>& pending, uint workers) -> void {
+  atomic<uint> next{0};
+  auto worker = [&](uintptr) {
+    Bass bass;
+    bass.phase = Phase::Write;
+    bass.constants = constants;
+    bass.importedConstants = importedConstants;
+    bass.relaxSizes = relaxSizes;
+    //results that would have printed anything are left to the Write phase, so that it is printed once and in order
+    bool reported = false;
+    bass.diagnostics([&](const string&) { reported = true; });
+    bool prepared = false;  //architecture is that of architectureName, with no bits pending
+
+    for(uint index = next++; index < pending.size(); index = next++) {
+      auto& e = encodings[pending[index]];
+      try {
+        if(!e.dataLength && (!prepared || bass.architectureName != e.architecture)) {
+          bass.createArchitecture(e.architecture);
+          prepared = true;
+        }
+        bass.origin = e.origin;
+        bass.base = e.base;
+        bass.endian = e.endian;
+        bass.lastLabelCounter = e.lastLabelCounter;
+        bass.nextLabelCounter = e.nextLabelCounter;
+        bass.scope = e.scope ? e.scope.split(".") : string_vector{};
+        //variables as they were; constants as they are now
+        bass.frames.reset();
+        bass.frames.append({0, false});
+        for(auto& input : e.inputs) {
+          if(!bass.findConstant(input.name)) bass.frames[0].variables.insert(input);
+        }
+
+        Encoding result;
+        bass.encoding = &result;
+        reported = false;
+        bool assembled = true;
+        if(e.dataLength) bass.assembleData(e.statement, e.dataLength);
+        else assembled = bass.architecture->assemble(e.statement);
+        bass.encoding = nullptr;
+        if(!e.dataLength && !bass.architecture->aligned()) prepared = false;  //bits are pending; start over with a new table
+        if(!assembled || reported || !result.reusable || result.forward || !e.dataLength && !prepared) continue;
+        e.inputs = move(result.inputs);
+        e.data = move(result.data);
+        e.forward = false;
+      } catch(...) {
+        bass.encoding = nullptr;
+        prepared = false;
+      }
+    }
+  };
+
+  vector<thread> threads;
+  for(uint n : range(workers - 1)) threads.append(thread::create(worker));
+  worker(0);
+  for(auto& thread : threads) thread.join();
+}
+
+//with fixups enabled, the Query phase can write the target itself: it is executed once, and the Write phase then only
+//assembles the instructions and data that evaluated forward references (fixups), now that every constant is known
+//the layout cannot change in between, so each fixup is written over the bytes the Query phase wrote for it
+//anything else that depends on a forward reference (conditions, constants, tables, fixups that change size) undefers:
+//the target is rolled back, and the program is assembled in two phases after all
+auto Bass::deferAssembly() -> bool {
+  if(!reuseEncodings || relaxPasses || objectFilename || checkpointing) return false;
+
+  auto constants = this->constants;
+  auto tracker = this->tracker;
+  auto checksums = this->checksums;
+  targetFile.journal(true);
+  auto image = targetFile.checkpoint();
+  auto imageSize = targetFile.size();
+  auto position = targetFile.offset();
+  deferring = true;
+  deferredLog.reset();
+  try {
+    phase = Phase::Query;
+    architecture = new Architecture{*this};
+    journal.reset();
+    queryCheckpoints.reset();
+    execute();
+    queryJournal = journal.size();
+    encodeForward();
+
+    phase = Phase::Write;
+    writeFixups();
+  } catch(...) {
+    //errors are reported again by the Query phase, as if assembling in two phases from the start
+    deferring = false;
+    targetFile.rollback(image, imageSize);
+    targetFile.seek(position);
+    targetFile.journal(false);
+    this->constants = constants;
+    this->tracker = tracker;
+    this->checksums = checksums;
+    charactersUseMap = false;
+    encoding = nullptr;
+    deferredLog.reset();
+    return false;
+  }
+  deferring = false;
+  targetFile.journal(false);
+  for(auto& message : deferredLog) report(message);
+  deferredLog.reset();
+  return true;
+}
+
+//called where the Query phase would depend on a forward reference outside of a fixup
+auto Bass::undefer() -> void {
+  if(deferring) throw Undeferred{};
+}
+
+//the Query phase has written a fixup with forward references evaluated to pc()
+auto Bass::recordFixup(Encoding& e) -> void {
+  if(!e.reusable) undefer();
+  if(targetFile && targetFile.offset() != origin) undefer();  //not written where its origin says
+  e.length = e.data.size();
+  encodings.append(move(e));
+}
+
+//encodes every fixup again, and writes it over the bytes the Query phase wrote for it
+auto Bass::writeFixups() -> void {
+  //an imported constant may have been used before the program defined its own, which takes precedence (see importSymbols())
+  bool shadowed = false;
+  if(importedConstants) constants.foreach([&](const Constant& constant) {
+    string name = constant.name;
+    while(!shadowed) {
+      if(importedConstants.find({name})) shadowed = true;
+      auto dot = name.find(".");
+      if(!dot) break;
+      name = slice(name, dot() + 1);
+    }
+  });
+  if(shadowed) undefer();
+
+  vector<uint> pending;
+  for(uint n : range(encodings.size())) {
+    if(encodings[n].forward) pending.append(n);
+  }
+  encodeFixups(pending, 1);
+  for(auto& e : encodings) {
+    if(e.forward || e.data.size() != e.length) undefer();
+    if(!targetFile) continue;
+    targetFile.seek(e.origin);
+    targetFile.write(e.data);
+  }
+}
@@ -1,15 +1,41 @@
+//the constant that a relative label (--, -, + or ++) refers to, which is not an expression
+auto Bass::relativeLabel(const string& expression) const -> maybe<string> {
+  if(expression == "--") return string{"lastLabel#", lastLabelCounter - 2};
+  if(expression == "-" ) return string{"lastLabel#", lastLabelCounter - 1};
+  if(expression == "+" ) return string{"nextLabel#", nextLabelCounter + 0};
+  if(expression == "++") return string{"nextLabel#", nextLabelCounter + 1};
+  return nothing;
+}
+
 auto Bass::evaluate(const string& expression, Evaluation mode) -> int64_t {
-  maybe<string> name;
-  if(expression == "--") name = {"lastLabel#", lastLabelCounter - 2};
-  if(expression == "-" ) name = {"lastLabel#", lastLabelCounter - 1};
-  if(expression == "+" ) name = {"nextLabel#", nextLabelCounter + 0};
-  if(expression == "++") name = {"nextLabel#", nextLabelCounter + 1};
-  if(name) {
-    if(auto constant = findConstant({name()})) return constant().value;
-    if(queryPhase()) return pc();
+  if(auto name = relativeLabel(expression)) {
+    if(auto constant = findConstant({name()})) return symbolValue(constant());
+    if(encoding) encoding->forward = true;
+    else undefer();
+    if(queryPhase()) return groupValue(pc(), pcGroup());
     error("relative label not declared");
   }
 
+  return evaluate(parse(expression), mode);
+}
+
+//for expressions that may not be valid: nothing is reported, and an invalid expression has no value
+auto Bass::evaluateQuietly(const string& expression) -> maybe<int64_t> {
+  bool quiet = this->quiet;
+  this->quiet = true;
+  maybe<int64_t> value;
+  try {
+    value = evaluate(expression);
+  } catch(const Undeferred&) {
+    this->quiet = quiet;
+    throw;
+  } catch(...) {
+  }
+  this->quiet = quiet;
+  return value;
+}
+
+auto Bass::parse(const string& expression) -> Eval::Node* {
   Eval::Node* node = nullptr;
   try {
     node = Eval::parse(expression);
@@ -18,7 +44,7 @@ auto Bass::evaluate(const string& expression, Evaluation mode) -> int64_t {
   } catch(...) {
     error("malformed expression: ", expression);
   }
-  return evaluate(node, mode);
+  return node;
 }
 
 auto Bass::evaluate(Eval::Node* node, Evaluation mode) -> int64_t {
@@ -61,6 +87,15 @@ auto Bass::evaluate(Eval::Node* node, Evaluation mode) -> int64_t {
 }
 
 //calculates the number of parameters to a function without evaluating its arguments yet
+//whether evaluating the expression would assign to a variable
+auto Bass::assigns(Eval::Node* node) const -> bool {
+  if(node->type >= Eval::Node::Type::Assign && node->type <= Eval::Node::Type::AssignConcatenate) return true;
+  for(auto& link : node->link) {
+    if(assigns(link)) return true;
+  }
+  return false;
+}
+
 auto Bass::quantifyParameters(Eval::Node* node) -> int64_t {
   if(node->type == Eval::Node::Type::Null) return 0;
   if(node->type == Eval::Node::Type::Separator) return node->link.size();
@@ -78,6 +113,8 @@ auto Bass::evaluateParameters(Eval::Node* node, Evaluation mode) -> vector<int64
 auto Bass::evaluateExpression(Eval::Node* node, Evaluation mode) -> int64_t {
   string name = node->link[0]->literal;
   if(auto parameters = quantifyParameters(node->link[1])) name.append("#", parameters);
+  //origin, base and pc are compared before an encoding is reused; other functions may depend on state that is not
+  if(encoding && name != "origin" && name != "base" && name != "pc") encoding->reusable = false;
 
   if(name == "array.size#1") {
     string s = evaluateString(node->link[1]);
@@ -104,17 +141,20 @@ auto Bass::evaluateExpression(Eval::Node* node, Evaluation mode) -> int64_t {
   if(name == "file.size#1") {
     string filename = evaluateString(node->link[1]).trim("\"", "\"", 1L);
     string location = {filepath(), filename};
-    if(file::exists(location)) return file::size(location);
+    depend(location);
+    if(auto fp = openInput(location)) return fp.size();
     error("file not found: ", filename);
     return 0;
   }
   if(name == "file.exists#1") {
     string filename = evaluateString(node->link[1]).trim("\"", "\"", 1L);
     string location = {filepath(), filename};
-    return file::exists(location);
+    depend(location);
+    return inputExists(location);
   }
   if(name == "read#1") {
     if(!targetFile) error("no target file open for reading");
+    undefer();  //the image does not hold its fixups yet
     int64_t address = evaluate(node->link[1], mode);
     auto origin = targetFile.offset();
     targetFile.seek(address);
@@ -124,7 +164,7 @@ auto Bass::evaluateExpression(Eval::Node* node, Evaluation mode) -> int64_t {
   }
   if(name == "origin") return origin;
   if(name == "base") return base;
-  if(name == "pc") return pc();
+  if(name == "pc") return groupValue(pc(), pcGroup());
 
   if(auto expression = findExpression(name)) {
     auto parameters = evaluateParameters(node->link[1], mode);
@@ -164,18 +204,55 @@ auto Bass::evaluateLiteral(Eval::Node* node, Evaluation mode) -> int64_t {
   if(s[0] >= '0' && s[0] <= '9') return toInteger(s);
   if(s[0] == '%') return toBinary(s);
   if(s[0] == '$') return toHex(s);
-  if(s.match("'?*'")) return character(s);
+  if(s.match("'?*'")) {
+    if(encoding) encoding->reusable = false;  //the string table may differ by then
+    return character(s);
+  }
 
-  if(auto variable = findVariable(s)) return variable().value;
-  if(auto constant = findConstant(s)) return constant().value;
-  if(mode != Evaluation::Strict && queryPhase()) return pc();
+  if(auto variable = findVariable(s)) {
+    if(encoding) encoding->inputs.append({s, variable().value});
+    return variable().value;
+  }
+  if(auto constant = findConstant(s)) {
+    if(encoding) encoding->inputs.append({s, constant().value});
+    return symbolValue(constant());
+  }
+  if(encoding) encoding->forward = true;
+  else undefer();
+  if(mode != Evaluation::Strict && queryPhase()) return groupValue(pc(), pcGroup());  //in object mode, assumed to be in the current section until defined
 
   error("unrecognized variable: ", s);
   return 0;
 }
 
+//decodes plain numeric literals (eg 255, $ff, 0xff, %1111, 0b1111, 0o377) without building an expression tree
+//returns nothing for anything else, which must then go through evaluate()
+auto Bass::decodeLiteral(const string& s) -> maybe<int64_t> {
+  const char* p = s.data();
+  uint radix = 10;
+  if(0);
+  else if(p[0] == '$') radix = 16, p += 1;
+  else if(p[0] == '%') radix =  2, p += 1;
+  else if(p[0] == '0' && p[1] == 'x') radix = 16, p += 2;
+  else if(p[0] == '0' && p[1] == 'b') radix =  2, p += 2;
+  else if(p[0] == '0' && p[1] == 'o') radix =  8, p += 2;
+  if(!*p) return nothing;
+
+  uint64_t value = 0;
+  while(char c = *p++) {
+    uint digit = 16;
+    if(c >= '0' && c <= '9') digit = c - '0';
+    if(c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+    if(digit >= radix) return nothing;
+    value = value * radix + digit;
+  }
+  return (int64_t)value;
+}
+
 auto Bass::evaluateSubscript(Eval::Node* node, Evaluation mode) -> int64_t {
   string& s = node->link[0]->literal;
+  if(encoding) encoding->reusable = false;
 
   if(auto array = findArray(s)) {
     auto index = evaluate(node->link[1], mode);
@@ -191,6 +268,7 @@ auto Bass::evaluateSubscript(Eval::Node* node, Evaluation mode) -> int64_t {
 
 auto Bass::evaluateAssign(Eval::Node* node, Evaluation mode) -> int64_t {
   string& s = node->link[0]->literal;
+  if(encoding) encoding->reusable = false;
 
   if(auto variable = findVariable(s)) {
     variable().value = evaluate(node->link[1], mode);
@@ -1,8 +1,21 @@
 auto Bass::execute() -> bool {
   frames.reset();
   conditionals.reset();
+  loops.reset();
   ip = 0;
+  reach = 0;
+  executed = 0;
   macroInvocationCounter = 0;
+  statements = 0;
+  segmentEnded = false;
+  if(queryPhase()) {
+    encodings.reset();
+    outputs.reset();
+    independentOutputs = threadCount != 1;
+  }
+  encoding = nullptr;
+  encodingIndex = 0;
+  architectureName = {};
 
   initialize();
 
@@ -11,13 +24,58 @@ auto Bass::execute() -> bool {
     setDefine(define.name, {}, define.value, Frame::Level::Inline);
   }
 
-  while(ip < program.size()) {
+  run();
+
+  if(segmentEnded) return true;  //the state is verified by writeOutputs()
+  frames.removeRight();
+  return true;
+}
+
+//executes statements from ip to the end of the program, taking checkpoints along the way when enabled
+auto Bass::run() -> void {
+  while(ip < program.size() && !segmentEnded) {
+    if(checkpointing) {
+      executed++;
+      if(frames.size() == 1) {
+        if(converging && convergence.candidates[ip] >= 0 && converged(convergence.candidates[ip])) break;
+        if(executed >= Checkpoint::Interval) checkpoint();
+      }
+    }
+
     Instruction& i = program(ip++);
+    if(ip > reach) reach = ip;
+    statements++;
     if(!executeInstruction(i)) error("unrecognized directive: ", i.statement);
   }
+}
 
-  frames.removeRight();
-  return true;
+//repeats the Query phase until no constant changes, so that encodings can be chosen by the size of forward references
+//each pass evaluates forward references to their value from the previous pass, rather than to pc()
+//if that never settles (within relaxPasses, or because the passes oscillate), default encodings are used instead
+auto Bass::relaxQuery() -> void {
+  vector<uint64_t> digests;
+  for(queryPass = 1; queryPass < relaxPasses; queryPass++) {
+    passConstants.reset();
+    constantsChanged = false;
+    constantsDigest = 0;
+    architecture = new Architecture{*this};
+    execute();
+    if(!constantsChanged) break;
+    if(digests.find(constantsDigest)) { queryPass = relaxPasses; break; }
+    digests.append(constantsDigest);
+  }
+  bool converged = queryPass < relaxPasses;
+  queryPass = 0;
+  passConstants.reset();
+  if(converged) return;
+
+  activeInstruction = nullptr;
+  notice("size relaxation did not converge, using default encodings");
+  relaxSizes = false;
+  constants.reset();
+  for(auto& constant : predefinedConstants) constants.insert(constant);
+  architecture = new Architecture{*this};
+  execute();
 }
 
 auto Bass::executeInstruction(Instruction& i) -> bool {
@@ -173,6 +231,60 @@ auto Bass::executeInstruction(Instruction& i) -> bool {
     return true;
   }
 
+  //for name = first to last [step amount] {
+  if(s.match("for ?* {")) {
+    s.trim("for ", " {", 1L).strip();
+    auto p = s.split("=", 1L).strip();
+    auto r = p(1).split(" to ", 1L).strip();
+    auto q = r(1).split(" step ", 1L).strip();
+    if(p.size() != 2 || r.size() != 2) error("invalid for loop: ", s);
+    int64_t first = evaluate(r(0), Evaluation::Strict);
+    int64_t last = evaluate(q(0), Evaluation::Strict);
+    int64_t step = q.size() == 2 ? evaluate(q(1), Evaluation::Strict) : 1;
+    if(step == 0) error("for loop step cannot be zero");
+    //the span is computed unsigned, as last - first may not fit in an int64_t
+    uint64_t count = 0;
+    if(step > 0 && last >= first) count = ((uint64_t)last - (uint64_t)first) / (uint64_t)step + 1;
+    if(step < 0 && last <= first) count = ((uint64_t)first - (uint64_t)last) / (0 - (uint64_t)step) + 1;
+    if(count == 0 && (step > 0 ? last >= first : last <= first)) error("for loop has too many iterations");
+    setVariable(p(0), first, level);
+    if(count == 0) {
+      ip = i.ip;
+      return true;
+    }
+    loops.append({p(0), first, step, count});
+    return true;
+  }
+
+  //repeat count {
+  if(s.match("repeat ?* {")) {
+    s.trim("repeat ", " {", 1L).strip();
+    int64_t count = evaluate(s, Evaluation::Strict);
+    if(count <= 0) {
+      ip = i.ip;
+      return true;
+    }
+    loops.append({{}, 0, 0, (uint64_t)count});
+    return true;
+  }
+
+  //the loop state is kept natively: the header is only evaluated once,
+  //and each iteration jumps straight back to the first statement of the body
+  if(s.match("} endfor") || s.match("} endrepeat")) {
+    auto& loop = loops.right();
+    if(--loop.count == 0) {
+      loops.removeRight();
+      return true;
+    }
+    if(loop.name) {
+      loop.value += loop.step;
+      if(auto variable = findVariable(loop.name)) variable().value = loop.value;
+      else setVariable(loop.name, loop.value, level);
+    }
+    ip = i.ip;
+    return true;
+  }
+
   if(s.match("?*(*)")) {
     auto p = string{s}.trimRight(")", 1L).split("(", 1L).strip();
     auto name = p(0);
@@ -0,0 +1,395 @@
+auto Image::open(const string& filename, bool create) -> bool {
+  close();
+  if(!file.open(filename, create ? file_buffer::mode::write : file_buffer::mode::modify)) return false;
+  fileSize = imageSize = file.size();
+  position = 0;
+  return true;
+}
+
+//the image has no backing file, and is written sequentially to stdout when closed
+auto Image::open() -> bool {
+  close();
+  stream = true;
+  position = 0;
+  return true;
+}
+
+//as above, but the image is stored into output instead
+auto Image::open(vector<uint8_t>& output) -> bool {
+  open();
+  this->output = &output;
+  output.reset();
+  return true;
+}
+
+//the image is loaded from a read-only base file, and written as a patch against it when closed
+auto Image::patch(const string& baseFilename, const string& patchFilename) -> bool {
+  close();
+  if(!file.open(baseFilename, file_buffer::mode::read)) return false;
+  fileSize = imageSize = file.size();
+  position = 0;
+  this->patchFilename = patchFilename;
+  return true;
+}
+
+//returns a message for the caller to report when the patch could not be written
+auto Image::close() -> string {
+  if(patchFilename) {
+    string message = writePatch();
+    file.close();
+    pages.reset();
+    patchFilename = {};
+    fileSize = imageSize = position = 0;
+    return message;
+  }
+
+  if(stream) {
+    vector<uint8_t> zero;
+    zero.resize(PageSize);
+    if(output) output->resize(imageSize);
+    for(uint64_t address = 0; address < imageSize; address += PageSize) {
+      uint64_t index = address >> PageBits;
+      auto& data = index < pages.size() && pages[index].data ? pages[index].data : zero;
+      uint64_t length = min((uint64_t)PageSize, imageSize - address);
+      if(output) memory::copy<uint8_t>(output->data() + address, data.data(), length);
+      else fwrite(data.data(), 1, length, stdout);
+    }
+    if(!output) fflush(stdout);
+    stream = false;
+    output = nullptr;
+    pages.reset();
+    fileSize = imageSize = position = 0;
+    return {};
+  }
+
+  if(!file) return {};
+
+  //growing the file leaves a hole instead of writing out the gap
+  if(file.size() < imageSize) file.truncate(imageSize);
+
+  for(uint64_t index : range(pages.size())) {
+    auto& page = pages[index];
+    if(!page.dirty) continue;
+    uint64_t address = index << PageBits;
+    uint64_t length = min((uint64_t)PageSize, imageSize - address);
+    if(blank(page.data.data(), length)) {
+      if(address >= fileSize || page.blank) continue;  //already zero on disk
+      if(length == PageSize && file.discard(address, length)) continue;
+    }
+    file.seek(address);
+    file.write({page.data.data(), length});
+  }
+
+  file.close();
+  pages.reset();
+  fileSize = imageSize = position = 0;
+  return {};
+}
+
+//discards every write since the image was opened; the file is left as it was then
+auto Image::revert() -> void {
+  pages.reset();
+  imageSize = fileSize;
+  position = 0;
+  undo.reset();
+  epoch++;
+}
+
+//whether anything has been written since the image was opened
+auto Image::modified() const -> bool {
+  if(imageSize != fileSize) return true;
+  for(auto& page : pages) {
+    if(page.dirty) return true;
+  }
+  return false;
+}
+
+auto Image::journal(bool enable) -> void {
+  journaling = enable;
+  undo.reset();
+  epoch++;
+}
+
+//later writes can be undone back to this point with rollback()
+auto Image::checkpoint() -> uint64_t {
+  epoch++;
+  return undo.size();
+}
+
+//restores every page written since the checkpoint, and truncates the image (and its file) to its size back then
+//the file must have been reopened for modification, as its contents are the image as of the last close()
+auto Image::rollback(uint64_t checkpoint, uint64_t size) -> void {
+  while(undo.size() > checkpoint) {
+    auto entry = undo.takeRight();
+    auto& target = page(entry.index << PageBits);
+    if(entry.data) memory::copy<uint8_t>(target.data.data(), entry.data.data(), PageSize);
+    else memory::fill<uint8_t>(target.data.data(), PageSize);
+    target.dirty = true;
+  }
+  epoch++;
+
+  if(imageSize <= size) return;
+  imageSize = size;
+  if(file.size() > size) file.truncate(size);
+  if(fileSize > size) fileSize = size;
+  pages.resize(min(pages.size(), (size + PageSize - 1) >> PageBits));
+  //bytes past the new end read back as zeroes, should the image grow again
+  uint64_t index = size & PageSize - 1;
+  if(index && (size >> PageBits) < pages.size()) {
+    auto& target = pages[size >> PageBits];
+    if(target.data) memory::fill<uint8_t>(target.data.data() + index, PageSize - index);
+  }
+  if(position > size) position = size;
+}
+
+auto Image::seek(uint64_t offset) -> void {
+  if(!*this) return;
+  position = offset;
+  if(imageSize < position) imageSize = position;  //seeking past the end pads the image
+}
+
+auto Image::read() -> uint8_t {
+  if(position >= imageSize) return 0;  //cannot read past end of image
+  uint8_t data = page(position).data[position & PageSize - 1];
+  position++;
+  return data;
+}
+
+auto Image::read(array_span<uint8_t> memory) -> void {
+  uint8_t* data = memory.data();
+  uint64_t size = memory.size();
+  while(size) {
+    if(position >= imageSize) {
+      memory::fill<uint8_t>(data, size);
+      return;
+    }
+    uint64_t index = position & PageSize - 1;
+    uint64_t length = min(size, PageSize - index, imageSize - position);
+    memory::copy<uint8_t>(data, page(position).data.data() + index, length);
+    position += length;
+    data += length;
+    size -= length;
+  }
+}
+
+auto Image::write(array_view<uint8_t> memory) -> void {
+  if(!*this) return;
+  const uint8_t* data = memory.data();
+  uint64_t size = memory.size();
+  while(size) {
+    uint64_t index = position & PageSize - 1;
+    uint64_t length = min(size, PageSize - index);
+    auto& target = modify(position);
+    memory::copy<uint8_t>(target.data.data() + index, data, length);
+    position += length;
+    data += length;
+    size -= length;
+  }
+  if(imageSize < position) imageSize = position;
+}
+
+//zero fills of untouched pages past the original end of the file are skipped,
+//as those pages will be read back as zeroes anyway
+auto Image::fill(uint8_t data, uint64_t length) -> void {
+  if(!*this) return;
+  while(length) {
+    uint64_t index = position & PageSize - 1;
+    uint64_t size = min(length, PageSize - index);
+    uint64_t page = position >> PageBits;
+    bool untouched = page >= pages.size() || !pages[page].data;
+    if(data || !untouched || (page << PageBits) < fileSize) {
+      auto& target = modify(position);
+      memory::fill<uint8_t>(target.data.data() + index, size, data);
+    }
+    position += size;
+    length -= size;
+  }
+  if(imageSize < position) imageSize = position;
+}
+
+auto Image::page(uint64_t address) -> Page& {
+  uint64_t index = address >> PageBits;
+  if(index >= pages.size()) pages.resize(index + 1);
+  auto& page = pages[index];
+  if(!page.data) {
+    page.data.resize(PageSize);
+    address = index << PageBits;
+    if(address < fileSize) {
+      file.seek(address);
+      uint64_t length = min((uint64_t)PageSize, fileSize - address);
+      file.read({page.data.data(), length});
+      page.blank = blank(page.data.data(), length);
+    }
+  }
+  return page;
+}
+
+//a page about to be written: its prior contents are saved first when journaling
+auto Image::modify(uint64_t address) -> Page& {
+  auto& target = page(address);
+  if(journaling && target.epoch != epoch) {
+    Undo entry{address >> PageBits};
+    if(!blank(target.data.data(), PageSize)) entry.data = target.data;
+    undo.append(move(entry));
+    target.epoch = epoch;
+  }
+  target.dirty = true;
+  return target;
+}
+
+auto Image::blank(const uint8_t* data, uint64_t length) -> bool {
+  for(uint64_t n : range(length)) {
+    if(data[n]) return false;
+  }
+  return true;
+}
+
+//patches are generated directly from the modified pages: runs of bytes that differ from the base are
+//stored, and everything else is referenced from the base. IPS is used when the filename ends in .ips
+auto Image::writePatch() -> string {
+  bool ips = patchFilename.iendsWith(".ips");
+  vector<uint8_t> patch;
+  Hash::CRC32 sourceHash, targetHash;
+
+  auto encode = [&](uint64_t data) {
+    while(true) {
+      uint64_t x = data & 0x7f;
+      data >>= 7;
+      if(data == 0) { patch.append(0x80 | x); break; }
+      patch.append(x);
+      data--;
+    }
+  };
+
+  enum : uint { SourceRead, TargetRead, SourceCopy, TargetCopy };
+  enum : uint { Run = 16 };  //shortest run of a repeated byte that is stored as a run, rather than byte by byte
+  uint8_t previous = 0;      //last byte preceding the current run of changes
+  uint64_t targetOffset = 0; //BPS TargetCopy offsets are relative to the end of the previous copy
+  bool overflow = false;
+
+  auto runLength = [](array_view<uint8_t> data, uint64_t offset) -> uint64_t {
+    uint64_t length = 1;
+    while(offset + length < data.size() && data[offset + length] == data[offset]) length++;
+    return length;
+  };
+
+  auto unchanged = [&](uint64_t length) {
+    if(!ips) encode(SourceRead | length - 1 << 2);
+  };
+
+  auto changed = [&](uint64_t address, array_view<uint8_t> data) {
+    if(!ips) {
+      //the first byte of a run is read, and the rest copied from it one byte at a time
+      for(uint64_t offset = 0; offset < data.size();) {
+        uint64_t start = offset, run = 0;
+        while(start < data.size() && (run = runLength(data, start)) < Run) start += run;
+        uint64_t length = min(start + 1, (uint64_t)data.size()) - offset;
+        encode(TargetRead | length - 1 << 2);
+        for(uint64_t n : range(length)) patch.append(data[offset + n]);
+        offset += length;
+        if(start == data.size()) break;
+
+        int64_t relative = address + start - targetOffset;
+        encode(TargetCopy | run - 2 << 2);
+        encode((relative < 0 ? -relative : relative) << 1 | (relative < 0));
+        targetOffset = address + start + run - 1;
+        offset += run - 1;
+      }
+      return;
+    }
+
+    //an IPS record offset of "EOF" would end the patch early; start one byte sooner instead
+    vector<uint8_t> record;
+    if(address == 0x454f46) record.append(previous), address--;
+    for(auto byte : data) record.append(byte);
+
+    //runs are stored as RLE records, and the bytes between them as literal records
+    for(uint64_t offset = 0, length = 0; offset < record.size(); offset += length) {
+      uint64_t run = runLength(record, offset);
+      bool repeated = run >= Run || run == record.size() - offset && run > 3;
+      if(repeated) {
+        length = run;
+      } else {
+        length = 0;
+        while(offset + length < record.size() && length < 0xffff && (run = runLength(record, offset + length)) < Run) length += run;
+      }
+      length = min((uint64_t)0xffff, length);
+      if(address + offset + length == 0x454f46 && offset + length < record.size()) length += length > 1 ? -1 : 1;
+      if(address + offset + length > 0x1000000) { overflow = true; return; }
+      patch.appendm(address + offset, 3);
+      if(repeated) {
+        patch.appendm(0, 2);
+        patch.appendm(length, 2);
+        patch.append(record[offset]);
+      } else {
+        patch.appendm(length, 2);
+        for(uint64_t n : range(length)) patch.append(record[offset + n]);
+      }
+    }
+  };
+
+  if(ips) {
+    for(auto byte : string{"PATCH"}) patch.append(byte);
+  } else {
+    for(auto byte : string{"BPS1"}) patch.append(byte);
+    encode(fileSize);
+    encode(imageSize);
+    encode(0);  //no manifest
+  }
+
+  vector<uint8_t> source;
+  source.resize(PageSize);
+  vector<uint8_t> changes;
+  uint64_t changesAddress = 0;
+  uint64_t unchangedLength = 0;
+
+  for(uint64_t address = 0; address < imageSize; address += PageSize) {
+    uint64_t length = min((uint64_t)PageSize, imageSize - address);
+    uint64_t sourceLength = address < fileSize ? min(length, fileSize - address) : 0;
+    uint64_t index = address >> PageBits;
+    bool touched = index < pages.size() && pages[index].data;
+
+    //IPS does not need checksums, so untouched pages of the base never have to be read
+    if(!touched && ips && sourceLength == length) {
+      if(changes) changed(changesAddress, changes), changes.reset();
+      unchangedLength += length;
+      continue;
+    }
+
+    memory::fill<uint8_t>(source.data(), PageSize);
+    if(sourceLength) {
+      file.seek(address);
+      file.read({source.data(), sourceLength});
+      sourceHash.input(source.data(), sourceLength);
+    }
+    const uint8_t* target = touched ? pages[index].data.data() : source.data();
+    targetHash.input(target, length);
+
+    for(uint64_t n : range(length)) {
+      if(n >= sourceLength || target[n] != source[n]) {
+        if(unchangedLength) unchanged(unchangedLength), unchangedLength = 0;
+        if(!changes) changesAddress = address + n;
+        changes.append(target[n]);
+      } else {
+        if(changes) changed(changesAddress, changes), changes.reset();
+        unchangedLength++;
+        previous = target[n];
+      }
+    }
+  }
+  if(changes) changed(changesAddress, changes);
+  if(unchangedLength) unchanged(unchangedLength);
+
+  if(overflow) return "warning: IPS patches cannot modify data beyond 16MB\n";
+
+  if(ips) {
+    for(auto byte : string{"EOF"}) patch.append(byte);
+  } else {
+    patch.appendl(sourceHash.value(), 4);
+    patch.appendl(targetHash.value(), 4);
+    patch.appendl(Hash::CRC32(patch).value(), 4);
+  }
+
+  if(!file::write(patchFilename, patch)) return {"warning: unable to write patch file: ", patchFilename, "\n"};
+  return {};
+}
@@ -0,0 +1,67 @@
+//sparse, page-granular in-memory copy of a target file
+//pages are read from disk on first access, and only modified pages are written back by close()
+struct Image {
+  enum : uint { PageBits = 12, PageSize = 1 << PageBits };
+
+  Image() = default;
+  Image(const Image&) = delete;
+  auto operator=(const Image&) -> Image& = delete;
+  ~Image() { close(); }
+
+  explicit operator bool() const { return file || stream; }
+  auto offset() const -> uint64_t { return position; }
+  auto size() const -> uint64_t { return imageSize; }
+  auto streaming() const -> bool { return stream; }
+
+  auto open(const string& filename, bool create) -> bool;
+  auto open() -> bool;
+  auto open(vector<uint8_t>& output) -> bool;
+  auto patch(const string& baseFilename, const string& patchFilename) -> bool;
+  auto close() -> string;
+  auto revert() -> void;
+  auto modified() const -> bool;
+  auto seek(uint64_t offset) -> void;
+  auto read() -> uint8_t;
+  auto read(array_span<uint8_t> memory) -> void;
+  auto write(array_view<uint8_t> memory) -> void;
+  auto fill(uint8_t data, uint64_t length) -> void;
+
+  auto journal(bool enable) -> void;
+  auto checkpoint() -> uint64_t;
+  auto rollback(uint64_t checkpoint, uint64_t size) -> void;
+
+  auto write(uint8_t data) -> void { write({&data, 1}); }
+  auto writel(uint64_t data, uint length) -> void { for(uint n : range(length)) write(uint8_t(data >> n * 8)); }
+  auto writem(uint64_t data, uint length) -> void { for(uint n : reverse(range(length))) write(uint8_t(data >> n * 8)); }
+
+private:
+  struct Page {
+    vector<uint8_t> data;  //empty until first accessed
+    bool dirty = false;
+    bool blank = false;    //page was all zeroes on disk when it was loaded
+    uint epoch = 0;        //journal epoch of the last write
+  };
+
+  //contents of a page before its first write following a checkpoint
+  struct Undo {
+    uint64_t index;
+    vector<uint8_t> data;  //empty when the page was all zeroes
+  };
+
+  auto page(uint64_t address) -> Page&;
+  auto modify(uint64_t address) -> Page&;
+  auto writePatch() -> string;
+  static auto blank(const uint8_t* data, uint64_t length) -> bool;
+
+  file_buffer file;
+  bool stream = false;     //image is written to stdout (or output) by close()
+  vector<uint8_t>* output = nullptr;
+  string patchFilename;    //base file is left unmodified, and close() writes a BPS or IPS patch here instead
+  vector<Page> pages;
+  uint64_t fileSize = 0;   //size of the file on disk when it was opened
+  uint64_t imageSize = 0;
+  uint64_t position = 0;
+  bool journaling = false; //writes are journaled, so that they can be rolled back to a checkpoint
+  uint epoch = 1;
+  vector<Undo> undo;       //kept when the image is closed
+};
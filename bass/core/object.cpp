@@ -0,0 +1,382 @@
+//assembles into a relocatable object file rather than a target
+//sections, exported symbols and relocations are then placed and resolved by link()
+auto Bass::object(const string& filename) -> void {
+  objectFilename = filename;
+  targetFilenames.insert(filename);
+}
+
+auto Bass::link(const string& filename) -> bool {
+  if(!file::exists(filename)) {
+    report("warning: object file not found: ", filename, "\n");
+    return false;
+  }
+  objectFilenames.append(filename);
+  depend(filename);
+  return true;
+}
+
+//places a linked section at a fixed target file offset, rather than after the previous section
+auto Bass::place(const string& section, uint64_t offset, int64_t base) -> void {
+  Placement placement;
+  placement.name = section;
+  placement.offset = offset;
+  placement.base = base;
+  placement.fixed = true;
+  placements.insert(section, placement);
+}
+
+//
+
+auto Bass::pcGroup() const -> int {
+  return objectFilename ? (int)sectionIndex : (int)Reference::Absolute;
+}
+
+//evaluates an expression, and determines which section or extern (if any) its value is relative to
+//this is found by evaluating it again with each referenced section or extern displaced:
+//the value must then either move with it, or not at all
+//otherwise, it may be such an address shifted right or masked by constants (e.g. label >> 16 & 0xff)
+auto Bass::reference(const string& expression) -> Reference {
+  if(!objectFilename) return {evaluate(expression)};
+
+  //the expression is parsed once for all of these evaluations
+  Eval::Node* node = relativeLabel(expression) ? nullptr : parse(expression);
+  auto value = [&](Eval::Node* node) -> int64_t {
+    return node ? evaluate(node, Evaluation::Default) : evaluate(expression);
+  };
+
+  //false when the value of node does not move linearly with the groups it reads
+  auto locate = [&](Eval::Node* node, Reference& result) -> bool {
+    referencedGroups.reset();
+    result = {value(node)};
+    auto groups = referencedGroups;
+    for(int group : groups) {
+      uint moved = 0;
+      for(int64_t displacement : {0x1, 0x1000, 0x10000000}) {
+        perturbedGroup = group;
+        perturbation = displacement;
+        int64_t difference = value(node) - result.value;
+        perturbedGroup = Reference::Absolute;
+        perturbation = 0;
+        if(difference == displacement) moved++;
+        else if(difference != 0) return false;
+      }
+      if(moved == 0) continue;
+      if(moved != 3) return false;
+      if(result.group != Reference::Absolute) error("expression is relative to more than one section or extern: ", expression);
+      result.group = group;
+    }
+    return true;
+  };
+
+  //the value of node when it does not depend on any group
+  auto constant = [&](Eval::Node* node) -> maybe<int64_t> {
+    referencedGroups.reset();
+    int64_t result = value(node);
+    if(referencedGroups) return nothing;
+    return result;
+  };
+
+  //finds the operand that shifts and masks are applied to, accumulating them as (operand >> shift) & mask
+  uint shift = 0;
+  int64_t mask = -1;
+  function<Eval::Node* (Eval::Node*)> operand = [&](Eval::Node* node) -> Eval::Node* {
+    if(node->type == Eval::Node::Type::ShiftRight) {
+      auto amount = constant(node->link[1]);
+      if(!amount || amount() < 0 || amount() >= 64) return node;
+      auto inner = operand(node->link[0]);
+      shift += amount();
+      mask >>= amount();
+      return inner;
+    }
+    if(node->type == Eval::Node::Type::BitwiseAnd) {
+      for(uint n : range(2)) {
+        auto bits = constant(node->link[n]);
+        if(!bits) continue;
+        auto inner = operand(node->link[1 - n]);
+        mask &= bits();
+        return inner;
+      }
+    }
+    return node;
+  };
+
+  Reference result{0};
+  try {
+    referencedGroups.reset();
+    perturbedGroup = Reference::Absolute;
+    perturbation = 0;
+    int64_t full = value(node);
+    //each evaluation would assign again, e.g. n = n + 1
+    if(referencedGroups && node && assigns(node)) error("expression that assigns to a variable cannot be relocated: ", expression);
+
+    if(!locate(node, result)) {
+      auto inner = node ? operand(node) : node;
+      Reference address{0};
+      if(inner == node || shift >= 64 || !locate(inner, address)) error("expression cannot be relocated: ", expression);
+      result = {full, address.group, shift, mask, address.value};
+      if(result.group == Reference::Absolute) result = {full};
+    }
+  } catch(...) {
+    perturbedGroup = Reference::Absolute;
+    perturbation = 0;
+    delete node;
+    throw;
+  }
+  delete node;
+  return result;
+}
+
+auto Bass::symbolValue(const Constant& constant) -> int64_t {
+  if(!objectFilename) return constant.value;
+  if(auto relocatable = relocatables.find({constant.name})) return groupValue(constant.value, relocatable().value);
+  return constant.value;
+}
+
+auto Bass::groupValue(int64_t value, int group) -> int64_t {
+  if(group == Reference::Absolute) return value;
+  if(!referencedGroups.find(group)) referencedGroups.append(group);
+  return group == perturbedGroup ? value + perturbation : value;
+}
+
+auto Bass::selectSection(const string& name, uint align) -> void {
+  sections[sectionIndex].origin = origin;
+  sections[sectionIndex].base = base;
+
+  auto index = sections.find([&](auto& section) { return section.name == name; });
+  if(!index) {
+    Section section;
+    section.name = name;
+    sections.append(section);
+    index = sections.size() - 1;
+  }
+  auto& section = sections[index()];
+  section.align = max(section.align, align);
+  sectionIndex = index();
+  origin = section.origin;
+  base = section.base;
+}
+
+auto Bass::sectionWrite(array_view<uint8_t> data) -> void {
+  auto& section = sections[sectionIndex];
+  if(section.data.size() < origin + data.size()) section.data.resize(origin + data.size());
+  memory::copy<uint8_t>(section.data.data() + origin, data.data(), data.size());
+}
+
+auto Bass::sectionFill(uint8_t data, uint64_t length) -> void {
+  auto& section = sections[sectionIndex];
+  if(section.data.size() < origin + length) section.data.resize(origin + length);
+  memory::fill<uint8_t>(section.data.data() + origin, length, data);
+}
+
+//object files are plain text, one record per line:
+//  section <name> <align> <data in hex>
+//  export <name> <section, or - if absolute> <value>
+//  extern <name>
+//  data <section> <offset> <pc> <lsb|msb> <length> <operand>
+//  code <section> <offset> <pc> <lsb|msb> <operand> [...] ; <table entry>
+//operands are a value, optionally followed by :<group>: a section number, or -2 - the extern number
+//a shifted or masked address is followed by :<shift>:<mask> as well, and its value is the addend before these are applied
+auto Bass::writeObject() -> void {
+  auto operand = [&](const Reference& reference) -> string {
+    if(reference.group == Reference::Absolute) return {reference.value};
+    if(!reference.linear()) return {reference.addend, ":", reference.group, ":", reference.shift, ":", reference.mask};
+    return {reference.value, ":", reference.group};
+  };
+
+  string object = "bass object\n";
+  for(auto& section : sections) {
+    object.append("section ", section.name, " ", section.align, " ");
+    for(auto byte : section.data) object.append(hex(byte, 2L));
+    object.append("\n");
+  }
+  for(auto& name : exports) {
+    auto constant = constants.find({name});
+    if(!constant) error("exported symbol not defined: ", name);
+    auto relocatable = relocatables.find({name});
+    int group = relocatable ? relocatable().value : (int)Reference::Absolute;
+    if(group < Reference::Absolute) error("extern cannot be exported: ", name);
+    object.append("export ", name, " ", group == Reference::Absolute ? string{"-"} : string{group}, " ", constant().value, "\n");
+  }
+  for(auto& name : externs) {
+    object.append("extern ", name, "\n");
+  }
+  for(auto& relocation : relocations) {
+    string endian = relocation.endian == Endian::LSB ? "lsb" : "msb";
+    string location = {relocation.section, " ", relocation.offset, " ", relocation.pc, " ", endian};
+    if(!relocation.opcode) {
+      object.append("data ", location, " ", relocation.length, " ", operand(relocation.operands.first()), "\n");
+    } else {
+      object.append("code ", location);
+      for(auto& reference : relocation.operands) object.append(" ", operand(reference));
+      object.append(" ; ", relocation.opcode, "\n");
+    }
+  }
+
+  if(!file::write(objectFilename, object)) error("unable to write object file: ", objectFilename);
+}
+
+//places the sections of every object into the target, then resolves their relocations
+//sections of the same name are joined in the order given, and placed in order of first appearance
+auto Bass::linkObjects() -> void {
+  struct Input {
+    string filename;
+    vector<string> sections;      //placement name of each section
+    vector<uint64_t> offsets;     //of each section within its placement
+    string_vector externs;
+    string_vector relocations;
+  };
+  vector<Input> inputs;
+  string_vector order;
+  auto alignUp = [](uint64_t offset, uint64_t align) -> uint64_t {
+    return offset + align - 1 & ~(align - 1);
+  };
+
+  //join sections
+  hashset<Constant> symbols;
+  map<string, string> symbolFiles;
+  vector<Constant> pendingSymbols;  //values relative to a section, resolved once placed
+  vector<string> pendingSections;
+  for(auto& filename : objectFilenames) {
+    Input input;
+    input.filename = filename;
+    auto lines = string::read(filename).split("\n");
+    if(lines(0) != "bass object") error("not a bass object file: ", filename);
+    for(auto& line : lines) {
+      auto p = line.split(" ");
+      if(p(0) == "section" && p.size() == 4) {
+        auto& name = p(1);
+        uint align = toNatural(p(2));
+        if(!placements.find(name)) {
+          Placement placement;
+          placement.name = name;
+          placements.insert(name, placement);
+        }
+        if(!order.find(name)) order.append(name);
+        auto& placement = placements.find(name)();
+        placement.align = max(placement.align, align);
+        uint64_t offset = alignUp(placement.data.size(), align);
+        placement.data.resize(offset);
+        for(uint n = 0; n + 1 < p(3).size(); n += 2) {
+          placement.data.append(toHex(slice(p(3), n, 2)));
+        }
+        input.sections.append(name);
+        input.offsets.append(offset);
+      } else if(p(0) == "export" && p.size() == 4) {
+        if(auto previous = symbolFiles.find(p(1))) {
+          error("symbol exported by both ", previous(), " and ", filename, ": ", p(1));
+        }
+        symbolFiles.insert(p(1), filename);
+        int64_t value = toInteger(p(3));
+        if(p(2) == "-") {
+          symbols.insert({p(1), value});
+        } else {
+          uint section = toNatural(p(2));
+          if(section >= input.sections.size()) error("invalid object file: ", filename);
+          pendingSymbols.append({p(1), value + (int64_t)input.offsets[section]});
+          pendingSections.append(input.sections[section]);
+        }
+      } else if(p(0) == "extern" && p.size() == 2) {
+        input.externs.append(p(1));
+      } else if(p(0) == "data" || p(0) == "code") {
+        input.relocations.append(line);
+      } else if(line && line != "bass object") {
+        error("invalid object file: ", filename);
+      }
+    }
+    inputs.append(input);
+  }
+
+  //place sections
+  uint64_t cursor = 0;
+  int64_t displacement = 0;
+  for(auto& name : order) {
+    auto& placement = placements.find(name)();
+    if(!placement.fixed) {
+      placement.base = displacement;
+      placement.offset = alignUp(cursor + displacement, placement.align) - displacement;
+    }
+    if((placement.offset + placement.base) & placement.align - 1) {
+      error("section ", name, " is placed at an address that is not aligned to ", placement.align);
+    }
+    cursor = placement.offset + placement.data.size();
+    displacement = placement.base;
+  }
+  for(auto& a : order) {
+    for(auto& b : order) {
+      if(a == b) break;
+      auto& x = placements.find(a)();
+      auto& y = placements.find(b)();
+      if(x.offset < y.offset + y.data.size() && y.offset < x.offset + x.data.size()) {
+        error("sections ", b, " and ", a, " overlap");
+      }
+    }
+  }
+
+  auto address = [&](const string& name) -> int64_t {
+    auto& placement = placements.find(name)();
+    return placement.offset + placement.base;
+  };
+  for(uint n : range(pendingSymbols.size())) {
+    symbols.insert({pendingSymbols[n].name, pendingSymbols[n].value + address(pendingSections[n])});
+  }
+
+  //write sections
+  for(auto& name : order) {
+    auto& placement = placements.find(name)();
+    origin = placement.offset;
+    seek(origin);
+    writeBlock(placement.data);
+  }
+
+  //resolve relocations
+  for(auto& input : inputs) {
+    auto resolve = [&](const string& operand) -> int64_t {
+      auto p = operand.split(":");
+      int64_t value = toInteger(p(0));
+      if(p.size() == 1) return value;
+      if(p.size() != 2 && p.size() != 4) error("invalid object file: ", input.filename);
+      int group = toInteger(p(1));
+      if(group >= 0) {
+        if(group >= input.sections.size()) error("invalid object file: ", input.filename);
+        value += input.offsets[group] + address(input.sections[group]);
+      } else {
+        uint index = -2 - group;
+        if(index >= input.externs.size()) error("invalid object file: ", input.filename);
+        auto symbol = symbols.find({input.externs[index]});
+        if(!symbol) error("undefined extern in ", input.filename, ": ", input.externs[index]);
+        value += symbol().value;
+      }
+      if(p.size() == 4) {
+        uint shift = toNatural(p(2));
+        if(shift >= 64) error("invalid object file: ", input.filename);
+        value = value >> shift & toInteger(p(3));
+      }
+      return value;
+    };
+
+    for(auto& line : input.relocations) {
+      auto parts = line.split(" ; ", 1L);
+      auto p = parts(0).split(" ");
+      if(p.size() < 6) error("invalid object file: ", input.filename);
+      uint section = toNatural(p(1));
+      if(section >= input.sections.size()) error("invalid object file: ", input.filename);
+      uint64_t offset = toNatural(p(2)) + input.offsets[section];
+      int64_t pc = toInteger(p(3)) + input.offsets[section] + address(input.sections[section]);
+      auto& placement = placements.find(input.sections[section])();
+      endian = p(4) == "msb" ? Endian::MSB : Endian::LSB;
+      origin = placement.offset + offset;
+      base = pc - origin;
+      seek(origin);
+
+      if(p(0) == "data") {
+        write(resolve(p(6)), toNatural(p(5)));
+      } else {
+        vector<int64_t> operands;
+        for(uint n : range(5, p.size())) operands.append(resolve(p(n)));
+        Table table{*this, parts(1)};
+        table.encode(operands);
+      }
+    }
+  }
+  base = 0;
+}
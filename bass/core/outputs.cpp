@@ -0,0 +1,155 @@
+//programs that write several files with output statements can have the Write phase of each file run on a thread of its own
+//this requires that each output statement is executed once, from the top level of the program (not from within a macro,
+//conditional or loop), and creates its file: should the Write phase turn out to differ from the Query phase, everything is
+//simply written again in order
+
+auto Bass::recordOutput(const string& filename, bool create) -> void {
+  if(!independentOutputs) return;
+
+  if(loopBodies.size() != program.size()) {
+    loopBodies.reset();
+    uint depth = 0;
+    for(auto& instruction : program) {
+      if(instruction.statement.match("} endwhile") && depth) depth--;
+      loopBodies.append(depth > 0);
+      if(instruction.statement.match("while ?* {")) depth++;
+    }
+  }
+
+  bool independent = create && frames.size() == 1 && !conditionals && !loops && !loopBodies[ip - 1];
+  independent &= architecture->aligned();
+  for(auto& output : outputs) {
+    if(output.filename == filename) independent = false;
+  }
+  if(!independent) {
+    independentOutputs = false;
+    outputs.reset();
+    return;
+  }
+
+  auto state = capture();
+  state.ip = ip - 1;
+  outputs.append({filename, move(state), statements - 1});
+}
+
+//the outputs are split into groups of about the same number of Query phase statements, one per thread,
+//while the statements before the first output are run by this thread
+//each group starts from the Query phase state at its first output statement, and is valid when it ends in the
+//Query phase state at the first output statement of the next group, without having defined any constant differently
+//diagnostics are held back, and printed in order once all groups are known to be valid
+auto Bass::writeOutputs() -> bool {
+  if(!independentOutputs || !outputs || objectFilename || checkpointing) return false;
+  for(auto& output : outputs) {
+    if(inputFilenames.find(output.filename)) return false;
+  }
+  uint workers = threadCount ? threadCount : std::thread::hardware_concurrency();
+  if(workers < 2) return false;
+
+  struct Group {
+    uint first;  //outputs [first, last)
+    uint last;
+    shared_pointer<Bass> bass;
+    string messages;
+    bool valid = false;
+  };
+  vector<Group> groups;
+  uint64_t total = statements - outputs.first().statements;
+  uint count = min(outputs.size(), workers - 1);
+  for(uint n : range(outputs.size())) {
+    uint64_t position = outputs[n].statements - outputs.first().statements;
+    if(!groups || groups.size() < count && position * count >= total * groups.size()) groups.append({n, n + 1});
+    else groups.last().last = n + 1;
+  }
+
+  //the state the groups start from; this thread's Write phase may modify its own
+  auto queryConstants = constants;
+  auto queryCompressed = compressed;
+  auto worker = [&](uintptr index) {
+    auto& group = groups[index];
+    auto& state = outputs[group.first].state;
+    group.bass = new Bass;
+    auto& bass = *group.bass;
+    bass.phase = Phase::Write;
+    bass.program = program;
+    bass.sourceFilenames = sourceFilenames;
+    bass.constants = queryConstants;
+    bass.importedConstants = importedConstants;
+    bass.compressed = queryCompressed;
+    bass.cacheDirectory = cacheDirectory;
+    bass.memoryFiles = memoryFiles;
+    bass.fileProvider = fileProvider;
+    bass.strict = strict;
+    bass.relaxSizes = relaxSizes;
+    bass.diagnostics([&](const string& message) { group.messages.append(message); });
+    bass.segmenting = true;
+    bass.segmentOutputs = group.last - group.first;
+    try {
+      bass.resume(state);
+      bass.createArchitecture(state.architectureName);
+      bass.directives = state.directives;
+      bass.endian = state.endian;
+      bass.run();
+      if(group.last < outputs.size()) {
+        auto& next = outputs[group.last].state;
+        group.valid = bass.segmentEnded && bass.ip == next.ip && bass.sameState(next);
+      } else {
+        group.valid = !bass.segmentEnded;
+      }
+      group.valid &= !bass.constantsChanged;
+    } catch(...) {
+    }
+  };
+
+  vector<thread> threads;
+  for(uint n : range(groups.size())) threads.append(thread::create(worker, n));
+
+  auto handler = diagnosticHandler;
+  auto logged = diagnosticLog.size();  //the messages held back are logged once they are reported
+  string messages;
+  diagnostics([&](const string& message) { messages.append(message); });
+  constantsChanged = false;
+  segmenting = true;
+  segmentOutputs = 0;
+  bool valid = false;
+  try {
+    execute();
+    auto& next = outputs.first().state;
+    valid = segmentEnded && ip == next.ip && sameState(next) && !constantsChanged;
+    //the Query phase leaves its last output open as the target: it is then created again by a group, so nothing may be written to it yet
+    for(auto& output : outputs) {
+      if(output.filename == targetFilename && targetFile.modified()) valid = false;
+    }
+  } catch(...) {
+  }
+  diagnosticLog.resize(logged);
+  segmenting = false;
+  segmentEnded = false;
+  frames.reset();
+  for(auto& thread : threads) thread.join();
+  diagnosticHandler = handler;
+
+  for(auto& group : groups) valid &= group.valid;
+  if(!valid) {
+    for(auto& group : groups) group.bass->targetFile.revert();
+    targetFile.revert();
+    checksums.reset();
+    tracker.reset();
+    constants = move(queryConstants);
+    architecture = new Architecture{*this};
+    return false;
+  }
+
+  //targets are closed in the order the Write phase would have closed them
+  if(messages) report(messages);
+  closeTarget();
+  for(auto& group : groups) {
+    auto& bass = *group.bass;
+    if(group.messages) report(group.messages);
+    bass.closeTarget();
+    for(auto& region : bass.regions) regions.append(region);
+    for(auto& filename : bass.targetFilenames) targetFilenames.insert(filename);
+    for(auto& filename : bass.inputFilenames) inputFilenames.insert(filename);
+    cacheable &= bass.cacheable;
+  }
+  return true;
+}
@@ -0,0 +1,104 @@
+//symbol files hold the final constants of an assembly, and the contents of any target ranges marked with region
+//import makes them available to another assembly, which then does not have to assemble the shared code itself
+//format: "BASSSYM1", constant count (4), then per constant: name length (2), name, value (8);
+//region count (4), then per region: offset (8), length (8), data; all values are little-endian
+auto Bass::symbols(const string& filename) -> void {
+  symbolFilename = filename;
+  targetFilenames.insert(filename);
+}
+
+//regions are read from the target right before it is closed, once checksums are in place
+auto Bass::captureRegions() -> void {
+  for(auto& region : regions) {
+    if(region.captured) continue;
+    region.data.resize(region.length);
+    targetFile.seek(region.offset);
+    targetFile.read({region.data.data(), region.data.size()});
+    region.captured = true;
+  }
+}
+
+//the constants of the last assembly, sorted by name
+//anonymous labels are left out, as they would be found in place of an importing program's own
+auto Bass::symbols() const -> vector<Constant> {
+  vector<Constant> symbols;
+  constants.foreach([&](const Constant& constant) {
+    if(!constant.name.find("#")) symbols.append(constant);
+  });
+  symbols.sort();
+  return symbols;
+}
+
+auto Bass::writeSymbols() -> void {
+  auto symbols = this->symbols();
+  file_buffer fp{symbolFilename, file_buffer::mode::write};
+  if(!fp) error("unable to write symbol file: ", symbolFilename);
+  fp.writes("BASSSYM1");
+  fp.writel(symbols.size(), 4);
+  for(auto& symbol : symbols) {
+    fp.writel(symbol.name.size(), 2);
+    fp.writes(symbol.name);
+    fp.writel(symbol.value, 8);
+  }
+  fp.writel(regions.size(), 4);
+  for(auto& region : regions) {
+    fp.writel(region.offset, 8);
+    fp.writel(region.length, 8);
+    fp.write(region.data);
+  }
+}
+
+//constants defined by the program itself take precedence over imported ones
+//regions are written to the target in the Write phase, at the file offsets they were exported from
+auto Bass::importSymbols(const string& filename) -> void {
+  depend(filename);
+  auto input = openInput(filename);
+  if(!input) error("symbol file not found: ", filename);
+  const uint8_t* data = input.data();
+  uint64_t size = input.size();
+  uint64_t offset = 0;
+
+  auto read = [&](uint64_t length) -> array_view<uint8_t> {
+    if(length > size - offset) error("symbol file is truncated: ", filename);
+    offset += length;
+    return {data + offset - length, length};
+  };
+  auto readl = [&](uint length) -> uint64_t {
+    auto bytes = read(length);
+    uint64_t value = 0;
+    for(uint n : range(length)) value |= (uint64_t)bytes[n] << n * 8;
+    return value;
+  };
+  auto reads = [&](uint length) -> string {
+    auto bytes = read(length);
+    string text;
+    text.resize(length);
+    memory::copy<uint8_t>((uint8_t*)text.get(), bytes.data(), length);
+    return text;
+  };
+
+  if(size < 8 || reads(8) != "BASSSYM1") error("not a bass symbol file: ", filename);
+
+  uint count = readl(4);
+  for(uint n : range(count)) {
+    uint length = readl(2);
+    string name = reads(length);
+    int64_t value = readl(8);
+    if(auto constant = importedConstants.find({name})) constant().value = value;
+    else importedConstants.insert({name, value});
+  }
+
+  count = readl(4);
+  for(uint n : range(count)) {
+    uint64_t target = readl(8);
+    uint64_t length = readl(8);
+    auto bytes = read(length);
+    if(!emitting() || !targetFile) continue;
+    uint previous = origin;
+    origin = target;
+    seek(origin);
+    writeBlock(bytes);
+    origin = previous;
+    seek(origin);
+  }
+}
@@ -161,15 +161,32 @@ auto Bass::findVariable(const string& name) -> maybe<Variable&> {
   return nothing;
 }
 
-auto Bass::setConstant(const string& name, int64_t value) -> void {
+auto Bass::setConstant(const string& name, int64_t value, int group) -> void {
   if(!validate(name)) error("invalid constant identifier: ", name);
   string scopedName = {scope.merge("."), scope ? "." : "", name};
 
+  //object mode: labels and constants computed from them are relocated by the linker
+  if(objectFilename) {
+    if(auto relocatable = relocatables.find({scopedName})) relocatable().value = group;
+    else if(group != Reference::Absolute) relocatables.insert({scopedName, group});
+  }
+
+  //later Query passes redefine the constants of the previous pass
+  if(queryPhase() && queryPass) {
+    if(passConstants.find({scopedName})) error("constant cannot be modified: ", scopedName);
+    passConstants.insert({scopedName, value});
+    constantsDigest += (scopedName.hash() * 0x9e3779b97f4a7c15ull) ^ value;
+  }
+
   if(auto constant = constants.find({scopedName})) {
-    if(queryPhase()) error("constant cannot be modified: ", scopedName);
+    if(queryPhase() && !queryPass) error("constant cannot be modified: ", scopedName);
+    if(constant().value != value) constantsChanged = true;
+    if(checkpointing) journal.append({scopedName, true, constant().value, value});
     constant().value = value;
   } else {
     constants.insert({scopedName, value});
+    constantsChanged = true;
+    if(checkpointing) journal.append({scopedName, false, 0, value});
   }
 }
 
@@ -184,6 +201,10 @@ auto Bass::findConstant(const string& name) -> maybe<Constant&> {
     s.removeRight();
   }
 
+  if(auto constant = importedConstants.find({name})) {
+    return constant();
+  }
+
   return nothing;
 }
 
@@ -272,13 +293,72 @@ auto Bass::readArchitecture(const string& s) -> string {
   string location{Path::userData(), "bass/architectures/", s, ".arch"};
   if(!file::exists(location)) location = {Path::program(), "architectures/", s, ".arch"};
   if(!file::exists(location)) error("unknown architecture: ", s);
+  depend(location);
   return string::read(location);
 }
 
+//creates the architecture that architectureName describes: its arch statement, followed by any instrument statements
+auto Bass::createArchitecture(const string& name) -> void {
+  auto statements = name.split("\n");
+  if(!statements(0) || statements(0) == "none") architecture = new Architecture{*this};
+  else architecture = new Table{*this, readArchitecture(statements(0))};
+  for(uint n : range(1, statements.size())) architecture->assemble(statements[n]);
+  architectureName = name;
+}
+
 auto Bass::filepath() -> string {
   return Location::path(sourceFilenames[activeInstruction->fileNumber]);
 }
 
+//files given to source() with their contents, and those supplied by the files() provider, take precedence over the file system
+//neither can be checked for changes by the build cache
+auto Bass::inputExists(const string& filename) -> bool {
+  if(memoryFiles.find(filename) || fileProvider && fileProvider(filename)) {
+    cacheable = false;
+    return true;
+  }
+  return file::exists(filename);
+}
+
+auto Bass::openInput(const string& filename) -> InputFile {
+  InputFile input;
+  if(auto data = memoryFiles.find(filename)) {
+    input.buffer.resize(data().size());
+    memory::copy<uint8_t>(input.buffer.data(), data().data(), data().size());
+    input.found = true;
+  } else if(auto data = fileProvider ? fileProvider(filename) : nothing) {
+    input.buffer = move(data());
+    input.found = true;
+  } else {
+    input.mapped.open(filename, file_map::mode::read);
+    input.found = (bool)input.mapped;
+    return input;
+  }
+  cacheable = false;
+  return input;
+}
+
+auto Bass::readInput(const string& filename) -> string {
+  if(auto data = memoryFiles.find(filename)) {
+    cacheable = false;
+    return data();
+  }
+  if(auto data = fileProvider ? fileProvider(filename) : nothing) {
+    cacheable = false;
+    string result;
+    result.resize(data().size());
+    memory::copy<uint8_t>(result.get(), data().data(), data().size());
+    return result;
+  }
+  return file::read(filename);
+}
+
+//called before the file is read, so that its stamp predates what the assembly saw of it
+auto Bass::depend(const string& filename) -> void {
+  inputFilenames.insert(filename);
+  if(!readStamps.find(filename)) readStamps.insert(filename, stamp(filename));
+}
+
 //split argument list by commas, being aware of parenthesis depth and quotes
 auto Bass::split(const string& s) -> string_vector {
   string_vector result;
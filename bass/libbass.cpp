@@ -0,0 +1,80 @@
+//libbass
+//the assembler core without the command-line interface, for linking into other programs (see make library)
+//libbass.hpp is its public interface, implemented below on top of the Bass class
+
+#include "bass.hpp"
+#include "core/core.cpp"
+#include "architecture/table/table.cpp"
+
+#include "libbass.hpp"
+
+namespace libbass {
+
+struct Assembler::Core {
+  Bass bass;
+};
+
+Assembler::Assembler() : core(new Core) {}
+Assembler::~Assembler() = default;
+
+auto Assembler::target(const std::string& filename, bool create) -> bool {
+  return core->bass.target(filename.c_str(), create);
+}
+
+auto Assembler::target() -> void {
+  core->bass.target();
+}
+
+auto Assembler::image() const -> std::vector<uint8_t> {
+  auto& image = core->bass.image();
+  return {image.data(), image.data() + image.size()};
+}
+
+auto Assembler::source(const std::string& filename) -> bool {
+  return core->bass.source(filename.c_str());
+}
+
+auto Assembler::source(const std::string& filename, const std::string& data) -> bool {
+  return core->bass.source(filename.c_str(), string_view{data.data(), (uint)data.size()});
+}
+
+auto Assembler::files(const std::function<std::optional<std::vector<uint8_t>> (const std::string&)>& provider) -> void {
+  if(!provider) return core->bass.files({});
+  core->bass.files([=](const string& filename) -> maybe<vector<uint8_t>> {
+    auto data = provider(filename.data());
+    if(!data) return nothing;
+    vector<uint8_t> result;
+    result.resize(data->size());
+    memory::copy<uint8_t>(result.data(), data->data(), data->size());
+    return result;
+  });
+}
+
+auto Assembler::diagnostics(const std::function<void (const std::string&)>& handler) -> void {
+  if(!handler) return core->bass.diagnostics({});
+  core->bass.diagnostics([=](const string& message) { handler({message.data(), message.size()}); });
+}
+
+auto Assembler::define(const std::string& name, const std::string& value) -> void {
+  core->bass.define(name.c_str(), value.c_str());
+}
+
+auto Assembler::constant(const std::string& name, const std::string& value) -> void {
+  core->bass.constant(name.c_str(), value.c_str());
+}
+
+auto Assembler::assemble(bool strict) -> bool {
+  return core->bass.assemble(strict);
+}
+
+auto Assembler::symbols() const -> std::vector<Symbol> {
+  std::vector<Symbol> symbols;
+  for(auto& constant : core->bass.symbols()) symbols.push_back({constant.name.data(), constant.value});
+  return symbols;
+}
+
+auto Assembler::symbols(const std::string& filename) -> void {
+  core->bass.symbols(filename.c_str());
+}
+
+}
@@ -0,0 +1,58 @@
+//libbass
+//public interface of the assembler core (see make library)
+//it depends only on the standard library: nall and the rest of bass stay internal to out/libbass.a and out/libbass.so
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace libbass {
+
+struct Symbol {
+  std::string name;
+  int64_t value;
+};
+
+//one Assembler performs one assembly; create another for the next one
+struct Assembler {
+  Assembler();
+  ~Assembler();
+  Assembler(const Assembler&) = delete;
+  auto operator=(const Assembler&) -> Assembler& = delete;
+
+  //the default output: a file (create = overwrite, otherwise modify), or with no filename, memory read back by image()
+  auto target(const std::string& filename, bool create) -> bool;
+  auto target() -> void;
+  auto image() const -> std::vector<uint8_t>;
+
+  //sources from the file system, or from memory as if data were the contents of filename
+  auto source(const std::string& filename) -> bool;
+  auto source(const std::string& filename, const std::string& data) -> bool;
+
+  //provider is asked for every source, include and inserted file before the file system is searched
+  //it returns nothing for files it does not supply
+  auto files(const std::function<std::optional<std::vector<uint8_t>> (const std::string&)>& provider) -> void;
+
+  //diagnostics are passed to handler rather than printed to stderr
+  auto diagnostics(const std::function<void (const std::string&)>& handler) -> void;
+
+  auto define(const std::string& name, const std::string& value) -> void;
+  auto constant(const std::string& name, const std::string& value) -> void;
+  auto assemble(bool strict = false) -> bool;
+
+  //the constants of the last assembly, sorted by name
+  //symbols(filename) also writes them, along with exported regions, to a file for use with import
+  auto symbols() const -> std::vector<Symbol>;
+  auto symbols(const std::string& filename) -> void;
+
+private:
+  struct Core;
+  std::unique_ptr<Core> core;
+};
+
+}
@@ -35,6 +35,7 @@ struct Arguments {
   auto take(string_view name) -> bool;
   auto take(string_view name, bool& argument) -> bool;
   auto take(string_view name, string& argument) -> bool;
+  auto take(string_view name, string& argument, string& second) -> bool;
 
   auto begin() { return arguments.begin(); }
   auto end() { return arguments.end(); }
@@ -158,4 +159,16 @@ inline auto Arguments::take(string_view name, string& argument) -> bool {
   return false;
 }
 
+inline auto Arguments::take(string_view name, string& argument, string& second) -> bool {
+  for(uint index : range(arguments.size())) {
+    if(arguments[index].match(name) && arguments.size() > index + 2) {
+      arguments.remove(index);
+      argument = arguments.take(index);
+      second = arguments.take(index);
+      return true;
+    }
+  }
+  return false;
+}
+
 }
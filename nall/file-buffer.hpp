@@ -4,6 +4,7 @@
 #include <nall/array-span.hpp>
 #include <nall/array-view.hpp>
 #include <nall/inode.hpp>
+#include <nall/memory.hpp>
 #include <nall/range.hpp>
 #include <nall/stdint.hpp>
 #include <nall/string.hpp>
@@ -88,7 +89,21 @@ struct file_buffer {
   }
 
   auto read(array_span<uint8_t> memory) -> void {
-    for(auto& byte : memory) byte = read();
+    uint8_t* data = memory.data();
+    uint64_t size = memory.size();
+    while(size) {
+      if(!fileHandle || fileOffset >= fileSize) {  //cannot read past end of file
+        memory::fill<uint8_t>(data, size);
+        return;
+      }
+      bufferSynchronize();
+      uint64_t index = fileOffset & buffer.size() - 1;
+      uint64_t length = min(size, buffer.size() - index, fileSize - fileOffset);
+      memory::copy<uint8_t>(data, buffer.data() + index, length);
+      fileOffset += length;
+      data += length;
+      size -= length;
+    }
   }
 
   auto write(uint8_t data) -> void {
@@ -118,7 +133,51 @@ struct file_buffer {
   }
 
   auto write(array_view<uint8_t> memory) -> void {
-    for(auto& byte : memory) write(byte);
+    if(!fileHandle) return;             //file not open
+    if(fileMode == mode::read) return;  //writes not permitted
+    const uint8_t* data = memory.data();
+    uint64_t size = memory.size();
+    while(size) {
+      uint64_t index = fileOffset & buffer.size() - 1;
+      if(index == 0 && size >= buffer.size()) {
+        //whole pages are written straight to the file, bypassing the buffer
+        uint64_t length = size & ~(buffer.size() - 1);
+        if(bufferOffset >= 0 && (uint64_t)bufferOffset >= fileOffset && (uint64_t)bufferOffset < fileOffset + length) {
+          bufferOffset = -1;  //buffered page is about to be overwritten entirely
+          bufferDirty = false;
+        }
+        fseek(fileHandle, fileOffset, SEEK_SET);
+        (void)fwrite(data, 1, length, fileHandle);
+        fileOffset += length;
+        data += length;
+        size -= length;
+        if(fileOffset > fileSize) fileSize = fileOffset;
+        continue;
+      }
+      bufferSynchronize();
+      uint64_t length = min(size, buffer.size() - index);
+      memory::copy<uint8_t>(buffer.data() + index, data, length);
+      bufferDirty = true;
+      fileOffset += length;
+      data += length;
+      size -= length;
+      if(fileOffset > fileSize) fileSize = fileOffset;
+    }
+  }
+
+  auto fill(uint8_t data, uint64_t size) -> void {
+    if(!fileHandle) return;             //file not open
+    if(fileMode == mode::read) return;  //writes not permitted
+    while(size) {
+      bufferSynchronize();
+      uint64_t index = fileOffset & buffer.size() - 1;
+      uint64_t length = min(size, buffer.size() - index);
+      memory::fill<uint8_t>(buffer.data() + index, length, data);
+      bufferDirty = true;
+      fileOffset += length;
+      size -= length;
+      if(fileOffset > fileSize) fileSize = fileOffset;
+    }
   }
 
   template<typename... P> auto print(P&&... p) -> void {
@@ -147,7 +206,7 @@ struct file_buffer {
         seekOffset = fileSize;
       } else {                          //pad file to requested location
         fileOffset = fileSize;
-        while(fileSize < seekOffset) write(0);
+        fill(0, seekOffset - fileSize);
       }
     }
 
@@ -166,10 +225,28 @@ struct file_buffer {
 
   auto truncate(uint64_t size) -> bool {
     if(!fileHandle) return false;
+    flush();
+    bufferOffset = -1;
     #if defined(API_POSIX)
-    return ftruncate(fileno(fileHandle), size) == 0;
+    if(ftruncate(fileno(fileHandle), size) != 0) return false;
     #elif defined(API_WINDOWS)
-    return _chsize(fileno(fileHandle), size) == 0;
+    if(_chsize(fileno(fileHandle), size) != 0) return false;
+    #endif
+    fileSize = size;
+    if(fileOffset > fileSize) fileOffset = fileSize;
+    return true;
+  }
+
+  //deallocates a range of the file, which then reads back as zeroes
+  //returns false where this is not supported, in which case the range is left unmodified
+  auto discard(uint64_t offset, uint64_t length) -> bool {
+    if(!fileHandle) return false;
+    #if defined(PLATFORM_LINUX) && defined(FALLOC_FL_PUNCH_HOLE)
+    flush();
+    bufferOffset = -1;
+    return fallocate(fileno(fileHandle), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length) == 0;
+    #else
+    return false;
     #endif
   }
 
@@ -2,6 +2,11 @@
 
 #include <nall/file-buffer.hpp>
 
+#if defined(PLATFORM_LINUX)
+  #include <sys/ioctl.h>
+  #include <linux/fs.h>
+#endif
+
 namespace nall {
 
 struct file : inode {
@@ -16,9 +21,40 @@ struct file : inode {
 
   static auto copy(const string& sourcename, const string& targetname) -> bool {
     if(sourcename == targetname) return true;
+    #if defined(PLATFORM_LINUX)
+    //try to share (reflink) or copy the data in the kernel before falling back to a user space copy
+    if(int source = ::open(sourcename, O_RDONLY); source >= 0) {
+      bool result = false;
+      if(int target = ::open(targetname, O_WRONLY | O_CREAT | O_TRUNC, 0666); target >= 0) {
+        #if defined(FICLONE)
+        result = ioctl(target, FICLONE, source) == 0;
+        #endif
+        if(!result) {
+          struct stat data;
+          fstat(source, &data);
+          int64_t remaining = data.st_size;
+          while(remaining > 0) {
+            auto length = copy_file_range(source, nullptr, target, nullptr, remaining, 0);
+            if(length <= 0) break;
+            remaining -= length;
+          }
+          result = remaining == 0;
+        }
+        ::close(target);
+      }
+      ::close(source);
+      if(result) return true;
+    }
+    #endif
     if(auto reader = file::open(sourcename, mode::read)) {
       if(auto writer = file::open(targetname, mode::write)) {
-        for(uint64_t n : range(reader.size())) writer.write(reader.read());
+        vector<uint8_t> buffer;
+        buffer.resize(65536);
+        for(uint64_t offset = 0; offset < reader.size(); offset += buffer.size()) {
+          uint64_t length = min(buffer.size(), reader.size() - offset);
+          reader.read({buffer.data(), length});
+          writer.write({buffer.data(), length});
+        }
         return true;
       }
     }
@@ -23,8 +23,8 @@ struct hashset {
   auto operator=(const hashset& source) -> hashset& {
     reset();
     if(source.pool) {
-      for(uint n : range(source.count)) {
-        insert(*source.pool[n]);
+      for(uint n : range(source.length)) {
+        if(source.pool[n]) insert(*source.pool[n]);
       }
     }
     return *this;
@@ -81,6 +81,18 @@ struct hashset {
     length = size;
   }
 
+  template<typename F> auto foreach(F&& callback) -> void {
+    for(uint n : range(pool ? length : 0)) {
+      if(pool[n]) callback(*pool[n]);
+    }
+  }
+
+  template<typename F> auto foreach(F&& callback) const -> void {
+    for(uint n : range(pool ? length : 0)) {
+      if(pool[n]) callback((const T&)*pool[n]);
+    }
+  }
+
   auto find(const T& value) -> maybe<T&> {
     if(!pool) return nothing;
 
@@ -116,6 +128,17 @@ struct hashset {
         delete pool[hash];
         pool[hash] = nullptr;
         count--;
+
+        //reinsert the rest of the cluster, so that no probe sequence is broken by the gap
+        if(++hash >= length) hash = 0;
+        while(pool[hash]) {
+          T* item = pool[hash];
+          pool[hash] = nullptr;
+          uint slot = (*item).hash() & (length - 1);
+          while(pool[slot]) if(++slot >= length) slot = 0;
+          pool[slot] = item;
+          if(++hash >= length) hash = 0;
+        }
         return true;
       }
       if(++hash >= length) hash = 0;
@@ -15,6 +15,8 @@
   COW alone is very slightly faster than this allocator on large strings
 
   adaptive is thus very fast for all string sizes
+
+  reference counts are atomic, so that strings may be shared between threads
 *****/
 
 namespace nall {
@@ -25,7 +27,7 @@ inline string::string() : _data(nullptr), _capacity(SSO - 1), _size(0) {
 template<typename T>
 inline auto string::get() -> T* {
   if(_capacity < SSO) return (T*)_text;
-  if(*_refs > 1) _copy();
+  if(__atomic_load_n(_refs, __ATOMIC_ACQUIRE) > 1) _copy();
   return (T*)_data;
 }
 
@@ -36,7 +38,7 @@ inline auto string::data() const -> const T* {
 }
 
 inline auto string::reset() -> type& {
-  if(_capacity >= SSO && !--*_refs) memory::free(_data);
+  if(_capacity >= SSO && !__atomic_sub_fetch(_refs, 1, __ATOMIC_ACQ_REL)) memory::free(_data);
   _data = nullptr;
   _capacity = SSO - 1;
   _size = 0;
@@ -49,7 +51,7 @@ inline auto string::reserve(uint capacity) -> type& {
   if(_capacity < SSO) {
     _capacity = capacity;
     _allocate();
-  } else if(*_refs > 1) {
+  } else if(__atomic_load_n(_refs, __ATOMIC_ACQUIRE) > 1) {
     _capacity = capacity;
     _copy();
   } else {
@@ -73,7 +75,7 @@ inline auto string::operator=(const string& source) -> type& {
     _refs = source._refs;
     _capacity = source._capacity;
     _size = source._size;
-    ++*_refs;
+    __atomic_add_fetch(_refs, 1, __ATOMIC_RELAXED);
   } else {
     memory::copy(_text, source._text, SSO);
     _capacity = source._capacity;
@@ -107,7 +109,8 @@ inline auto string::_copy() -> void {
   auto _temp = memory::allocate<char>(_capacity + 1 + sizeof(uint));
   memory::copy(_temp, _data, _size = min(_capacity, _size));
   _temp[_size] = 0;
-  --*_refs;
+  //another owner may have made its own copy meanwhile, leaving this as the last reference
+  if(!__atomic_sub_fetch(_refs, 1, __ATOMIC_ACQ_REL)) memory::free(_data);
   _data = _temp;
   _refs = (uint*)(_data + _capacity + 1);
   *_refs = 1;
@@ -0,0 +1,13 @@
+// the target starts as a copy of a base image (-b), of which only the touched parts change
+architecture snes.cpu
+
+origin 0x20
+db read(0x20) + 1, read(0x4fff)
+origin 0x1ffe
+dd $12345678
+
+// past the end of the base
+origin 0x5000
+db "more"
+origin 0x6000
+db read(0x4ffe)
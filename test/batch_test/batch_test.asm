@@ -0,0 +1,10 @@
+// -batch, assembling one source several times with different options
+architecture snes.cpu
+
+if {defined region} {
+  db "{region}"
+} else {
+  db "none"
+}
+db version
+include "shared.asm"
@@ -0,0 +1,2 @@
+// included by every job, and lexed once
+dw $1234
@@ -0,0 +1,43 @@
+// fill, insert, copy, ds, table
+architecture snes.cpu
+
+// fill
+fill 3
+fill 5, $aa
+fill 0x11000, 0x55  // more than one write buffer
+fill 2, -1
+fill 0
+
+// insert
+insert whole, "block_test.dat"
+insert part, "block_test.dat", 0x1000, 0x20
+insert tail, "block_test.dat", 9990
+insert "block_test.dat", 9999, 100
+assert(whole.size == 10000)
+assert(part.size == 0x20)
+assert(tail.size == 10)
+assert(tail - whole == 10000 + 0x20)
+
+// copy reads back what was written, and may target a position past the end of the file
+variable end = pc()
+copy whole + 0x100, end, 0x2000
+origin end + 0x2000
+copy 0, end + 0x3000, 16
+origin end + 0x3010
+
+// ds skips forward, and back over data that is then written again
+db 1, 2, 3, 4
+ds 4
+ds -6
+db $ee
+
+// table writes all of its entries at once
+origin end + 0x3020
+table db, 300, i
+table dw, 16, i * 0x101
+table dl, 3, -i
+endian msb
+table dw, 4, i + 0x100
+table dd, 2, $11223344 + i
+endian lsb
+table db, 0, 1 / 0
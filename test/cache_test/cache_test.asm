@@ -0,0 +1,9 @@
+// -cache, restoring the outputs and diagnostics of an unchanged build
+architecture snes.cpu
+
+constant size = 0x100
+fill size, $ea
+insert "cache_test.dat"
+print "size = ", size, "\n"
+notice "notices are replayed as well"
+db file.size("cache_test.dat")
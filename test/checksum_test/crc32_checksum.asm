@@ -0,0 +1,13 @@
+// checksum crc32, in either endian, and checksums covering the result of another one
+architecture snes.cpu
+
+db "123456789"
+origin 0x10
+table db, 0x3000, i >> 4
+origin 0x3100
+checksum crc32, 0x3100, 0, 9
+endian msb
+checksum crc32, 0x3104, 0, 9
+endian lsb
+checksum crc32, 0x3108, 0x10, 0x3000
+checksum crc32, 0x310c, 0x3100, 12
@@ -0,0 +1,5 @@
+// checksum snes, at the HiROM header
+architecture snes.cpu
+
+table dw, 0x8000, i ^ 0x5a5a
+checksum snes, 0xffdc
@@ -0,0 +1,7 @@
+// checksum snes, over an image whose remainder past the largest power of two is not a power of two either
+architecture snes.cpu
+
+table db, 0x26000, i * 13 >> 4
+origin 0x7fc0
+db "MIRROR CHECKSUM TEST "
+checksum snes
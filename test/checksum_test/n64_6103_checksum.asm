@@ -0,0 +1,9 @@
+// checksum n64, 6103
+architecture n64.cpu
+
+endian msb
+dw $80371240
+origin 0x40
+table dw, 0x3f0, i * 0x01010101 ^ 0x12345678  // boot code, read by the 6105 checksum
+table dw, 0x800, i * 0x9e3779b9
+checksum n64, 6103
@@ -0,0 +1,7 @@
+// checksum snes, over an image whose size is not a power of two
+architecture snes.cpu
+
+table db, 0x18000, i * 7 >> 3
+origin 0x7fc0
+db "CHECKSUM TEST        "
+checksum snes
@@ -0,0 +1,17 @@
+// insert.codec, compressing the selected range of a file
+architecture snes.cpu
+
+insert.lzsa lzsa, "codec_test.dat"
+insert.huffman huffman, "codec_test.dat"
+insert.rle rle, "codec_test.dat", 0x200, 0x400
+insert.rle16 rle16, "codec_test.dat", 0x200, 0x400
+
+// the same data is compressed once, and gives the same result
+insert.lzsa again, "codec_test.dat"
+assert(again.size == lzsa.size)
+
+// names point at the compressed data, and their size is the compressed size
+assert(huffman == lzsa + lzsa.size)
+assert(rle == huffman + huffman.size)
+assert(rle16 == rle + rle.size)
+assert(rle.size < 0x400)
@@ -0,0 +1,33 @@
+// db, dw, dl, dd, dq
+architecture snes.cpu
+
+constant eight = 8
+
+// plain literals, decoded without the expression parser
+db 0, 1, 255, $7f, $Ff, 0x80, 0xfe, %1010, 0b0101, 0o17
+dw 0, 65535, $1234, 0xabcd, %1000000000000001, 0o177777
+dl $123456, 0xfedcba, 16777215
+dd $deadbeef, 0x01234567, 4294967295
+dq $0123456789abcdef, 0xfedcba9876543210
+
+// anything else goes through evaluate()
+db -1, -128, 'A', "bass", eight, eight * 2, (3), 1 + 1, ~0
+dw -2, 'z', eight << 8, label
+dd -1, $10 + $20, label
+
+// starts like a literal, but is an expression
+db 0xff >> 4, %11 + 1, 0o7 * 2, $10-1, 0b1|0b10
+label:
+
+// values wider than the data size are truncated
+db $1ff, 0x100
+dw $12345
+
+// msb endian
+endian msb
+dw $1234, 0xabcd, -2
+dl $123456
+dd $deadbeef, label
+dq 1
+endian lsb
+dw $1234
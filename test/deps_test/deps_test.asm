@@ -0,0 +1,11 @@
+// -MD, listing every file the assembly read or looked for
+architecture snes.cpu
+
+include "include/part.asm"
+insert "data file.dat"
+db file.size("include/table.dat")
+
+// files that do not exist are left out of the rule
+if file.exists("missing.dat") {
+  error "missing.dat exists"
+}
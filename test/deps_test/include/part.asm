@@ -0,0 +1,3 @@
+// included from deps_test.asm
+db "included", 0
+insert "table.dat"
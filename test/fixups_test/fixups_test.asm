@@ -0,0 +1,37 @@
+// -fixups: the Query phase writes the target, and the Write phase only fixes up forward references
+architecture snes.cpu
+
+// statements that are not instructions still run in the Write phase
+variable x = 0
+while x < 4 {
+  db x
+  x = x + 1
+}
+assert(x == 4)
+
+// forward references are encoded again
+loop:
+  lda forward
+  jmp loop
+  bra later
+  nop
+later:
+  ldx #forward >> 8
+
+// data directives with forward references are fixed up as well
+  dw forward, loop, forward + 1
+  db "ab", forward
+
+// variables that change between uses
+variable n = 1
+macro step() {
+  lda #n
+  n = n * 2
+}
+step()
+step()
+step()
+assert(n == 8)
+
+forward:
+  rts
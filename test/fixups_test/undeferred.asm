@@ -0,0 +1,11 @@
+// -fixups: anything else that depends on a forward reference is assembled in two phases after all
+architecture snes.cpu
+
+  jsr forward
+constant distance = forward - start
+start:
+  db distance
+  print "distance ", distance, "\n"
+
+forward:
+  rts
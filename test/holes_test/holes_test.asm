@@ -0,0 +1,26 @@
+// zero pages and gaps, which are left as holes in the file where the file system supports them
+architecture snes.cpu
+
+// a whole page of zeroes over existing data
+origin 0x1000
+fill 0x1000
+
+// part of a page
+origin 0x2800
+fill 0x100
+
+// a page of zeroes written byte by byte, then one byte of it changed back
+origin 0x3000
+for i = 0 to 0xfff {
+  db 0
+}
+origin 0x3456
+db $34
+
+// a gap past the end of the file, and zero fills past it
+origin 0x10000
+db 1
+fill 0x3000
+fill 0x10, $ee
+origin 0x18000
+fill 0x2000
@@ -0,0 +1,30 @@
+// modifying a target in place (-m), reading it back, and growing it
+architecture snes.cpu
+
+// bytes of the original file are read from the pages they are on
+origin 0x10
+db read(0x10) + 1, read(0x1fff), read(0x2fff)
+
+// writes in the middle of a page keep the rest of it
+origin 0x1800
+dw $1234
+origin 0x0ffe
+dd $deadbeef  // across two pages
+
+// writes are read back before the target is closed
+origin 0x2000
+db $5a
+db read(0x2000) ^ $ff
+copy 0x1000, 0x2100, 0x20
+
+// going backward
+origin 0x100
+db read(0x1800), read(0x1801)
+
+// growing the file, then going back over the new data
+origin 0x3000
+db 1, 2, 3
+origin 0x3800
+db read(0x3001), read(0x37ff)
+origin 0x3002
+db 4
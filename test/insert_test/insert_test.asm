@@ -0,0 +1,29 @@
+// insert, at and across page boundaries of the target and of the inserted file
+architecture snes.cpu
+
+// page-aligned in the target, several whole pages long
+origin 0x1000
+insert aligned, "insert_test.dat"
+assert(aligned.size == 20000)
+
+// unaligned in the target, starting mid-page in the file
+origin 0x7003
+insert unaligned, "insert_test.dat", 0x0ffd, 0x2005
+
+// a range ending at the end of the file, and one clipped by it
+insert ending, "insert_test.dat", 19000
+insert clipped, "insert_test.dat", 19990, 0x1000
+assert(ending.size == 1000)
+assert(clipped.size == 0x1000)  //the requested length, although only 10 bytes are written
+
+// nothing left to insert
+insert empty, "insert_test.dat", 20000
+assert(empty.size == 0)
+
+// over data written before, then partially overwritten again
+origin 0x20000
+fill 0x3000, $cc
+origin 0x20800
+insert "insert_test.dat", 0x800, 0x1800
+origin 0x21000
+db $11, $22
@@ -0,0 +1,17 @@
+// -obj: a library, with code and data in separate sections
+architecture snes.cpu
+export print, message, message.length
+
+print:
+  lda $0000,x
+  beq done
+  sta $2118
+  inx
+  bra print
+done:
+  rtl
+
+section data, 16
+message:
+  db "linked", 0
+constant message.length = pc() - message
@@ -0,0 +1,18 @@
+// -obj: the program, calling into lib.asm
+architecture snes.cpu
+extern print, message, message.length
+
+reset:
+  ldx.w #message
+  lda.b #message >> 8  //an extern shifted or masked is relocated as such
+  lda.b #message + 1 & 0xff
+  ldy.w #message.length
+  jsl print
+  bra reset
+  jmp reset
+  dl reset, print + 2
+  dw end - reset  //a difference within one section is not relocated
+end:
+
+section vectors
+  dw reset
@@ -0,0 +1,52 @@
+// for, repeat
+architecture snes.cpu
+
+variable count = 0
+
+for i = 0 to 7 {
+  db i
+}
+
+for i = 8 to 0 step -2 {
+  dw i
+}
+
+// empty range, body must not execute
+for i = 1 to 0 {
+  error "empty for loop executed"
+}
+
+repeat 3 {
+  for j = 1 to 3 {
+    count = count + j
+  }
+  nop
+}
+if count != 18 {
+  error "nested loop count mismatch"
+}
+
+// span wider than int64_t
+variable wide = 0
+for i = -0x4000000000000000 to 0x4000000000000000 step 0x2000000000000000 {
+  wide = wide + 1
+}
+if wide != 5 {
+  error "wide for loop count mismatch"
+}
+
+macro table(variable n) {
+  for k = 0 to n - 1 {
+    db k * k
+  }
+}
+table(4)
+
+repeat 0 {
+  error "empty repeat executed"
+}
+
+// table
+table db, 8, i * 2
+table dw, 4, 0x100 >> i
+table dd, 0, 1 / 0
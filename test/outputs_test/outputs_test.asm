@@ -0,0 +1,23 @@
+// output, with every file written on its own thread (-j)
+architecture snes.cpu
+
+constant shared = $42
+
+output "outputs_test.bin", create
+db "first", 0
+table db, 0x3000, i * 3
+db shared
+
+output "outputs_test_code.bin", create
+base 0x8000
+reset:
+  lda.w #shared  //sized, as -relax would otherwise pick the 8-bit form
+  jmp reset
+  dw later
+later:
+  db "second"
+
+output "outputs_test_data.bin", create
+origin 0x100
+dl reset, later
+fill 0x2000, $ff
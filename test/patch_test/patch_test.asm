@@ -0,0 +1,24 @@
+// the changes to a base image are written as a patch (-patch), and the base is left as it was
+architecture snes.cpu
+
+// short changes, with unchanged bytes in between
+origin 0x10
+db 1, 2, 3
+origin 0x18
+db read(0x18) + 1
+
+// runs of one byte, stored as a copy of the target (BPS) or as an RLE record (IPS)
+origin 0x1000
+fill 0x100, $ab
+origin 0x2ffc
+fill 0x2000, 0
+db "end of run"
+
+// bytes written with the value they already had are not changes
+origin 0x4800
+db read(0x4800), read(0x4801)
+
+// growing the image
+origin 0x5000
+db "new data"
+fill 0x40, $ff
@@ -0,0 +1,9 @@
+// -relax: operands of generic entries such as "jp *16" need not be expressions
+architecture gb.cpu
+
+start:
+  jp nz,start
+  jp z,start
+  jp start
+  jr nz,start
+  ld a,(start)
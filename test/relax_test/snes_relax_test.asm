@@ -0,0 +1,17 @@
+// -relax: operands without a size hint are matched by the size of their value
+architecture snes.cpu
+
+constant page = $80
+lda page        // a5 80
+lda $1234       // ad 34 12
+lda later       // a5 12, once a second Query pass knows its value
+lda.w page      // ad 80 00, size hints still apply
+lda <page       // a5 80
+
+// operands are evaluated once per statement
+variable n = 0
+lda 0 + (n = n + 1)
+lda 0 + (n = n + 1)
+assert(n == 2)
+
+constant later = $12
@@ -0,0 +1,19 @@
+// without a target, output is written to stdout once assembly ends
+architecture snes.cpu
+
+db "stdout", 0
+fill 0x1000 - 7, $20
+dw $1234
+
+// origin and ds move around in the output, as they do in a file
+origin 0x2000
+db $80
+origin 0x10
+db read(0x1000) + 1
+ds 2
+db $ff
+
+// copy and read() see what was written before
+copy 0, 0x2100, 7
+origin 0x2200
+db read(0x2103), read(0x2000)
@@ -0,0 +1,13 @@
+// shared code, assembled once and imported by sym_test.asm
+architecture snes.cpu
+base $8000
+
+origin $10
+print_char:
+  sta $2118
+  rts
+print_end:
+
+constant SCREEN = $7000
+
+region print_char - $8000, print_end - print_char
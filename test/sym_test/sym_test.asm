@@ -0,0 +1,13 @@
+// import: constants and regions of a symbol file written with -sym
+architecture snes.cpu
+base $8000
+
+import "lib.sym"
+
+origin 0
+  jsr print_char
+  lda #SCREEN
+  lda.b #print_end - print_char
+
+// the program's own constants take precedence
+constant SCREEN = $7400
@@ -0,0 +1,22 @@
+// -watch: the copy of watch_test.asm is replaced by this file while bass runs
+architecture snes.cpu
+
+macro seek(variable offset) {
+  origin offset
+  base 0x8000 + offset
+}
+
+seek(0)
+constant first = 1
+for i = 0 to 15 {
+  db i * first
+}
+
+seek(0x100)
+reset:
+  lda #$01
+  jmp reset
+  dw later
+later:
+  db "after", 0
+  db first, 2, 3
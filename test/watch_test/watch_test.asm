@@ -0,0 +1,21 @@
+// -watch: this file is assembled from a copy, which is then replaced by watch_edit.asm
+architecture snes.cpu
+
+macro seek(variable offset) {
+  origin offset
+  base 0x8000 + offset
+}
+
+seek(0)
+constant first = 1
+for i = 0 to 15 {
+  db i * first
+}
+
+seek(0x100)
+reset:
+  lda #$01
+  jmp reset
+  dw later
+later:
+  db "before"